@@ -0,0 +1,142 @@
+/*
+ * AllocationBench.java
+ * Purpose: Measures heap bytes allocated per request on the server hot path, per opcode.
+ * Design notes:
+ * - Calls RequestRouter.handle directly (no sockets, no log) on one thread and reads that
+ *   thread's allocation counter (com.sun.management.ThreadMXBean) before and after each run.
+ *   It uses the worker's entry point: request buffers in, one reused direct reply buffer out.
+ * - Requests are encoded and wrapped up front so only server-side work is counted. BOOK uses a fresh slot
+ *   every time (2,000 per facility) so every booking succeeds; QUERY_AVAIL hits the cache.
+ * - The "decode" row reads the two week-minute fields of a BOOK request alone.
+ * - The "worker" rows send real datagrams over loopback to one ServerWorker and read the
+ *   worker thread's counter: the whole receive/route/reply path of the server.
+ * - Each row runs once to warm up and once measured; results are bytes per request.
+ * Usage: java -cp bin AllocationBench [--requests 200000]
+ */
+
+import java.lang.management.ManagementFactory;
+import java.net.InetAddress;
+import java.net.InetSocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.DatagramChannel;
+import java.util.List;
+
+public class AllocationBench {
+    private static final com.sun.management.ThreadMXBean THREADS =
+            (com.sun.management.ThreadMXBean) ManagementFactory.getThreadMXBean();
+    private static volatile int sink;                     // defeats dead-code elimination
+
+    public static void main(String[] args) throws Exception {
+        int count = 200_000;                              // requests per measured run
+        for (int i = 0; i < args.length; i++) {
+            if (args[i].equals("--requests")) count = Integer.parseInt(args[++i]);
+        }
+        final int requests = count;
+
+        FacilityStore store = new FacilityStore();
+        RequestRouter router = new RequestRouter(new ReservationLogic(store), new MonitorRegistry(), 60_000);
+        InetAddress client = InetAddress.getLoopbackAddress();
+
+        ByteBuffer out = WireCodec.acquireMessageBuffer();   // reused reply buffer, as in ServerWorker
+        System.out.println("request       bytes/op");
+        for (int round = 0; round < 2; round++) {
+            boolean print = round == 1;                   // first round warms up
+            String prefix = "R" + round + "-";
+            byte[][] books = new byte[requests][];
+            ByteBuffer[] bookBufs = new ByteBuffer[requests];
+            for (int n = 0; n < requests; n++) {
+                books[n] = book(n, prefix + n / 2000, n % 2000);
+                bookBufs[n] = WireCodec.wrap(books[n]);
+            }
+            report(print, "BOOK", requests, () -> { for (ByteBuffer r : bookBufs) router.handle(client, 10_000, r, out, null); });
+
+            ByteBuffer query = WireCodec.wrap(query(1, prefix + 0, 0));
+            report(print, "QUERY_AVAIL", requests, () -> {
+                for (int n = 0; n < requests; n++) router.handle(client, 10_000, query.clear(), out, null);
+            });
+
+            ByteBuffer week = WireCodec.wrap(queryWeek(2, prefix + 0, 0, OccupancyBitmap.WEEK_MINUTES - 1));
+            report(print, "QUERY_WEEK", requests, () -> {
+                for (int n = 0; n < requests; n++) router.handle(client, 10_000, week.clear(), out, null);
+            });
+
+            ByteBuffer fields = ByteBuffer.wrap(books[0], books[0].length - 6, 6);
+            report(print, "decode", requests, () -> {
+                int sum = 0;
+                for (int n = 0; n < requests; n++) {
+                    fields.position(books[0].length - 6);
+                    sum += WireCodec.readWeekMinutes(fields) + WireCodec.readWeekMinutes(fields);
+                }
+                sink = sum;                                 // keep the loop alive
+            });
+        }
+        loopback(requests);
+    }
+
+    // Per-request allocation of a live worker thread, measured from outside it
+    private static void loopback(int requests) throws Exception {
+        RequestRouter router = new RequestRouter(new ReservationLogic(new FacilityStore()), new MonitorRegistry(), 60_000);
+        List<DatagramChannel> channels = ServerMain.bindChannels(new InetSocketAddress("127.0.0.1", 0), 1);
+        CallbackFanout fanout = new CallbackFanout(router, new MonitorRegistry(), channels.get(0).socket(), 0.0, 4096);
+        Thread worker = ServerMain.startWorkers(channels, 1, router, fanout, null, 0.0, null)[0];
+        try (DatagramChannel client = DatagramChannel.open()) {
+            client.connect(channels.get(0).getLocalAddress());
+            ByteBuffer resp = ByteBuffer.allocateDirect(64 * 1024);
+            byte[][] books = new byte[requests][];
+            for (int n = 0; n < requests; n++) books[n] = book(n, "W-" + n / 2000, n % 2000);
+            byte[] query = query(1, "W-0", 0);
+            for (int round = 0; round < 2; round++) {
+                long before = THREADS.getThreadAllocatedBytes(worker.getId());
+                for (int n = 0; n < requests; n++) {
+                    client.write(ByteBuffer.wrap(round == 0 ? books[n] : query)); // round 0 books, round 1 queries
+                    resp.clear();
+                    client.read(resp);                          // closed loop: one request in flight
+                }
+                long bytes = THREADS.getThreadAllocatedBytes(worker.getId()) - before;
+                System.out.printf("%-12s  %8.1f%n", round == 0 ? "worker BOOK" : "worker QUERY", bytes / (double) requests);
+            }
+        }
+        for (DatagramChannel ch : channels) ch.close();     // stops the worker
+    }
+
+    private static void report(boolean print, String name, int requests, Runnable run) {
+        long tid = Thread.currentThread().getId();
+        long before = THREADS.getThreadAllocatedBytes(tid);
+        run.run();
+        long bytes = THREADS.getThreadAllocatedBytes(tid) - before;
+        if (print) System.out.printf("%-12s  %8.1f%n", name, bytes / (double) requests);
+    }
+
+    private static byte[] book(long reqId, String facility, int slot) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 2 + 5 + 6);
+        header(out, Protocol.OP_BOOK, reqId, out.capacity() - Protocol.HEADER_LEN);
+        WireCodec.writeString(out, facility);
+        WireCodec.writeString(out, "bench");
+        WireCodec.writeWeekMinutes(out, slot * 5);
+        WireCodec.writeWeekMinutes(out, slot * 5 + 5);
+        return out.array();
+    }
+
+    private static byte[] query(long reqId, String facility, int day) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 1);
+        header(out, Protocol.OP_QUERY_AVAIL, reqId, out.capacity() - Protocol.HEADER_LEN);
+        WireCodec.writeString(out, facility);
+        out.put((byte) day);
+        return out.array();
+    }
+
+    private static byte[] queryWeek(long reqId, String facility, int from, int to) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 6);
+        header(out, Protocol.OP_QUERY_WEEK, reqId, out.capacity() - Protocol.HEADER_LEN);
+        WireCodec.writeString(out, facility);
+        WireCodec.writeWeekMinutes(out, from);
+        WireCodec.writeWeekMinutes(out, to);
+        return out.array();
+    }
+
+    private static void header(ByteBuffer out, int op, long reqId, int payloadLen) {
+        WireCodec.Header h = new WireCodec.Header();
+        h.version = Protocol.VERSION; h.opCode = op; h.requestId = reqId; h.flags = 0; h.payloadLen = payloadLen;
+        WireCodec.writeHeader(out, h);
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * ConflictCheckBench.java
+ * Purpose: Compares conflict-check cost of the original list scan, the sorted BookingIndex and
+ *          the OccupancyBitmap as the number of bookings per facility grows.
+ * Design notes:
+ * - Each facility is filled with N evenly spaced bookings; candidates are random 90-minute
+ *   intervals, so roughly half the checks hit a conflict.
+ * - The list scan reproduces the pre-index hasOverlap (every booking compared in turn); the index
+ *   check reproduces the binary-search overlap test that the bitmap replaced.
+ * Usage: java -cp bin ConflictCheckBench [--bookings 10,100,1000,2000] [--checks 2000000]
+ */
+
+import java.util.List;
+import java.util.Random;
+
+public class ConflictCheckBench {
+    public static void main(String[] args) {
+        String sizes = "10,100,1000,2000";                // bookings per facility
+        int checks = 2_000_000;                           // conflict checks per measurement
+        for (int i = 0; i < args.length; i++) {
+            switch (args[i]) {
+                case "--bookings": sizes = args[++i]; break;
+                case "--checks": checks = Integer.parseInt(args[++i]); break;
+            }
+        }
+
+        System.out.println("bookings  list-scan ns/op  index ns/op  bitmap ns/op");
+        for (String sz : sizes.split(",")) {
+            int n = Integer.parseInt(sz.trim());
+            Types.Facility f = fill(n);
+            List<Types.Booking> list = f.bookings.toList();
+            int[][] candidates = candidates(checks);
+
+            for (int warm = 0; warm < 3; warm++) {        // let the JIT settle before the last round
+                double scan = time(() -> listScan(list, candidates), checks);
+                double index = time(() -> indexCheck(f.bookings, candidates), checks);
+                double bitmap = time(() -> bitmapCheck(f.occupancy, candidates), checks);
+                if (warm == 2) System.out.printf("%8d  %15.1f  %11.1f  %12.1f%n", n, scan, index, bitmap);
+            }
+        }
+    }
+
+    // Facility with n non-overlapping bookings spread over the week
+    private static Types.Facility fill(int n) {
+        Types.Facility f = new Types.Facility("Bench");
+        int spacing = OccupancyBitmap.WEEK_MINUTES / n;
+        int length = Math.max(1, spacing / 2);
+        for (int i = 0; i < n; i++) {
+            int s = i * spacing;
+            Types.Booking b = new Types.Booking(i + 1, f.name, "bench", s, s + length);
+            f.bookings.add(b);
+            f.occupancy.set(s, s + length);
+        }
+        return f;
+    }
+
+    private static int[][] candidates(int count) {
+        Random rnd = new Random(42);
+        int[][] c = new int[count][2];
+        for (int i = 0; i < count; i++) {
+            c[i][0] = rnd.nextInt(OccupancyBitmap.WEEK_MINUTES - 90);
+            c[i][1] = c[i][0] + 90;
+        }
+        return c;
+    }
+
+    // Original O(n) scan from ReservationLogic.hasOverlap
+    private static int listScan(List<Types.Booking> bookings, int[][] cands) {
+        int hits = 0;
+        for (int[] c : cands) {
+            for (Types.Booking b : bookings) {
+                int bStart = b.start;
+                int bEnd = b.end;
+                if (Math.max(bStart, c[0]) < Math.min(bEnd, c[1])) { hits++; break; }
+            }
+        }
+        return hits;
+    }
+
+    // Former BookingIndex.overlaps: only bookings starting before the candidate's end can overlap
+    private static int indexCheck(BookingIndex idx, int[][] cands) {
+        int hits = 0;
+        for (int[] c : cands) {
+            int i = idx.lowerBound(c[1]) - 1;             // latest booking starting before end
+            if (i >= 0 && idx.endAt(i) > c[0]) hits++;    // ends are sorted: nothing earlier can overlap
+        }
+        return hits;
+    }
+
+    private static int bitmapCheck(OccupancyBitmap bm, int[][] cands) {
+        int hits = 0;
+        for (int[] c : cands) if (bm.anySet(c[0], c[1])) hits++;
+        return hits;
+    }
+
+    private static int sink;                              // keeps results observable to the JIT
+
+    private static double time(java.util.function.IntSupplier body, int ops) {
+        long t0 = System.nanoTime();
+        sink += body.getAsInt();
+        return (System.nanoTime() - t0) / (double) ops;
+    }
+}
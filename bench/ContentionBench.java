@@ -0,0 +1,92 @@
+/*
+ * ContentionBench.java
+ * Purpose: Measures RequestRouter throughput under lock contention.
+ * Design notes:
+ * - Calls RequestRouter.handle directly (no sockets) from T threads spread over F facilities,
+ *   so the result reflects locking in the router/store rather than the network stack.
+ * - Mix is 90% QUERY_AVAIL / 10% BOOK; each thread books distinct slots so most books succeed.
+ * Usage: java -cp bin ContentionBench [--threads 1,2,4,8,16] [--facilities 1,16,1024] [--seconds 2]
+ */
+
+import java.net.InetAddress;
+import java.nio.ByteBuffer;
+import java.util.concurrent.atomic.AtomicLong;
+
+public class ContentionBench {
+    public static void main(String[] args) throws Exception {
+        String threadList = "1,2,4,8,16";                 // thread counts to sweep
+        String facilityList = "1,16,1024";                // facility counts to sweep
+        int seconds = 2;                                  // measurement time per cell
+        for (int i = 0; i < args.length; i++) {
+            switch (args[i]) {
+                case "--threads": threadList = args[++i]; break;
+                case "--facilities": facilityList = args[++i]; break;
+                case "--seconds": seconds = Integer.parseInt(args[++i]); break;
+            }
+        }
+
+        System.out.println("facilities  threads  ops/s");
+        for (String fs : facilityList.split(",")) {
+            for (String ts : threadList.split(",")) {
+                int facilities = Integer.parseInt(fs.trim());
+                int threads = Integer.parseInt(ts.trim());
+                double rate = run(facilities, threads, seconds);
+                System.out.printf("%10d  %7d  %.0f%n", facilities, threads, rate);
+            }
+        }
+    }
+
+    private static double run(int facilities, int threads, int seconds) throws Exception {
+        FacilityStore store = new FacilityStore();
+        ReservationLogic logic = new ReservationLogic(store);
+        RequestRouter router = new RequestRouter(logic, new MonitorRegistry(), 60_000);
+        InetAddress client = InetAddress.getLoopbackAddress();
+        AtomicLong ops = new AtomicLong();
+        long deadline = System.nanoTime() + seconds * 1_000_000_000L;
+
+        Thread[] ts = new Thread[threads];
+        for (int t = 0; t < threads; t++) {
+            final int id = t;
+            ts[t] = new Thread(() -> {
+                long n = 0;
+                int slot = 0;
+                while (System.nanoTime() < deadline) {
+                    String facility = "Room" + ((id + n * 31) % facilities);
+                    byte[] req = (n % 10 == 9)
+                            ? book(n, facility, (id * 97 + slot++) % 2000)
+                            : query(n, facility, (int) (n % 7));
+                    router.handle(client, 10_000 + id, req, false);
+                    n++;
+                }
+                ops.addAndGet(n);
+            }, "contention-" + t);
+            ts[t].start();
+        }
+        for (Thread t : ts) t.join();
+        return ops.get() / (double) seconds;
+    }
+
+    private static byte[] query(long reqId, String facility, int day) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 1);
+        header(out, Protocol.OP_QUERY_AVAIL, reqId, out.capacity() - Protocol.HEADER_LEN);
+        WireCodec.writeString(out, facility);
+        out.put((byte) day);
+        return out.array();
+    }
+
+    private static byte[] book(long reqId, String facility, int slot) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 2 + 5 + 6);
+        header(out, Protocol.OP_BOOK, reqId, out.capacity() - Protocol.HEADER_LEN);
+        WireCodec.writeString(out, facility);
+        WireCodec.writeString(out, "bench");
+        WireCodec.writeWeekMinutes(out, slot * 5);
+        WireCodec.writeWeekMinutes(out, slot * 5 + 5);
+        return out.array();
+    }
+
+    private static void header(ByteBuffer out, int op, long reqId, int payloadLen) {
+        WireCodec.Header h = new WireCodec.Header();
+        h.version = Protocol.VERSION; h.opCode = op; h.requestId = reqId; h.flags = 0; h.payloadLen = payloadLen;
+        WireCodec.writeHeader(out, h);
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * GroupCommitBench.java
+ * Purpose: Measures BOOK throughput with the write-ahead log at several group-commit windows.
+ * Design notes:
+ * - Starts an in-process server (see ServerMain.bindChannels/startWorkers) with a fresh log in a
+ *   temporary directory for each window, then drives it with closed-loop UDP clients sending
+ *   only BOOKs. Replies come back only after the group commit holding them is forced to disk.
+ * - Each client books consecutive 5-minute slots on its own facilities, so every BOOK succeeds
+ *   and is logged. The "memory" row runs without a log as the upper bound.
+ * - Reports books/s, records per commit (group size) and commits/s.
+ * Usage: java -cp bin GroupCommitBench [--clients 32] [--seconds 3] [--windowsUs 0,200,1000,5000]
+ */
+
+import java.net.*;
+import java.nio.ByteBuffer;
+import java.nio.channels.DatagramChannel;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicLong;
+
+public class GroupCommitBench {
+    public static void main(String[] args) throws Exception {
+        int clients = 32;                                 // closed-loop client threads
+        int seconds = 3;                                  // measurement time per run
+        int workers = 2;                                  // receive threads
+        String windowList = "0,200,1000,5000";            // group-commit windows to sweep (us)
+        for (int i = 0; i < args.length; i++) {
+            switch (args[i]) {
+                case "--clients": clients = Integer.parseInt(args[++i]); break;
+                case "--seconds": seconds = Integer.parseInt(args[++i]); break;
+                case "--workers": workers = Integer.parseInt(args[++i]); break;
+                case "--windowsUs": windowList = args[++i]; break;
+            }
+        }
+
+        System.out.println("windowUs  clients  books/s  records/commit  commits/s");
+        run(-1, clients, seconds, workers);               // no log
+        for (String w : windowList.split(",")) run(Long.parseLong(w.trim()), clients, seconds, workers);
+    }
+
+    // One run; windowUs < 0 means no write-ahead log
+    private static void run(long windowUs, int clients, int seconds, int workers) throws Exception {
+        Path dir = Files.createTempDirectory("wal-bench");
+        WriteAheadLog wal = null;
+        FacilityStore store = new FacilityStore();
+        if (windowUs >= 0) {
+            wal = new WriteAheadLog(dir, windowUs, WriteAheadLog.DEFAULT_BATCH_BYTES);
+            wal.recover((lsn, body) -> WalRecord.apply(body, store));
+            wal.start();
+        }
+        ReservationLogic logic = new ReservationLogic(store, wal);
+        MonitorRegistry monitors = new MonitorRegistry();
+        RequestRouter router = new RequestRouter(logic, monitors, 60_000);
+        List<DatagramChannel> channels = ServerMain.bindChannels(new InetSocketAddress("127.0.0.1", 0), workers);
+        CallbackFanout fanout = new CallbackFanout(router, monitors, channels.get(0).socket(), 0.0, 4096);
+        fanout.start(1);
+        ServerMain.startWorkers(channels, workers, router, fanout, wal, 0.0, null);
+        int port = ((InetSocketAddress) channels.get(0).getLocalAddress()).getPort();
+
+        long commits0 = wal == null ? 0 : wal.commits();
+        double rate = drive(port, clients, seconds);
+        if (wal == null) {
+            System.out.printf("%8s  %7d  %7.0f  %14s  %9s%n", "memory", clients, rate, "-", "-");
+        } else {
+            long commits = wal.commits() - commits0;
+            System.out.printf("%8d  %7d  %7.0f  %14.1f  %9.0f%n", windowUs, clients, rate,
+                    wal.records() / (double) Math.max(1, commits), commits / (double) seconds);
+        }
+        for (DatagramChannel ch : channels) ch.close();   // stops the workers
+    }
+
+    // Run closed-loop clients for the given time and return completed BOOKs per second
+    private static double drive(int port, int clients, int seconds) throws Exception {
+        AtomicLong completed = new AtomicLong();
+        long deadline = System.nanoTime() + seconds * 1_000_000_000L;
+        Thread[] threads = new Thread[clients];
+        for (int c = 0; c < clients; c++) {
+            final int id = c;
+            threads[c] = new Thread(() -> runClient(id, port, deadline, completed), "bench-client-" + c);
+            threads[c].start();
+        }
+        for (Thread t : threads) t.join();
+        return completed.get() / (double) seconds;
+    }
+
+    private static void runClient(int id, int port, long deadline, AtomicLong completed) {
+        try (DatagramSocket sock = new DatagramSocket()) {
+            sock.setSoTimeout(500);
+            InetAddress server = InetAddress.getLoopbackAddress();
+            byte[] resp = new byte[64 * 1024];
+            long reqId = (long) id << 24;
+            int slot = 0;
+            while (System.nanoTime() < deadline) {
+                String facility = "G" + id + "-" + (slot / 2000);   // fresh facility before the week fills
+                byte[] req = book(++reqId, facility, slot++ % 2000);
+                sock.send(new DatagramPacket(req, req.length, server, port));
+                try {
+                    sock.receive(new DatagramPacket(resp, resp.length));
+                    completed.incrementAndGet();
+                } catch (SocketTimeoutException lost) { /* count only answered requests */ }
+            }
+        } catch (Exception e) {
+            System.out.println("client " + id + " failed: " + e);
+        }
+    }
+
+    private static byte[] book(long reqId, String facility, int slot) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 2 + 5 + 6);
+        WireCodec.Header h = new WireCodec.Header();
+        h.version = Protocol.VERSION; h.opCode = Protocol.OP_BOOK; h.requestId = reqId; h.flags = 0;
+        h.payloadLen = out.capacity() - Protocol.HEADER_LEN;
+        WireCodec.writeHeader(out, h);
+        WireCodec.writeString(out, facility);
+        WireCodec.writeString(out, "bench");
+        WireCodec.writeWeekMinutes(out, slot * 5);
+        WireCodec.writeWeekMinutes(out, slot * 5 + 5);
+        return out.array();
+    }
+}
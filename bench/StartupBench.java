@@ -0,0 +1,75 @@
+/*
+ * StartupBench.java
+ * Purpose: Measures server startup (state rebuild) time versus booking count: replaying the
+ *          write-ahead log from scratch against loading a memory-mapped snapshot.
+ * Design notes:
+ * - For each size, books that many 5-minute slots (2,000 per facility) through ReservationLogic
+ *   with a real log, waits until the last record is durable and writes a snapshot.
+ * - "replay" rebuilds a fresh store from the log alone; "snapshot" maps the snapshot into a
+ *   fresh store and replays the (empty) log tail after it, as ServerMain does.
+ * - Reports log and snapshot size on disk and both rebuild times.
+ * Usage: java -cp bin StartupBench [--bookings 10000,100000,1000000]
+ */
+
+import java.io.IOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.util.concurrent.CountDownLatch;
+import java.util.stream.Stream;
+
+public class StartupBench {
+    private static final int SLOTS = 2000;               // 5-minute bookings per facility
+
+    public static void main(String[] args) throws Exception {
+        String sizes = "10000,100000,1000000";          // booking counts to sweep
+        for (int i = 0; i < args.length; i++) {
+            if (args[i].equals("--bookings")) sizes = args[++i];
+        }
+
+        System.out.println("bookings  log MB  snapshot MB  replay ms  snapshot ms");
+        for (String s : sizes.split(",")) run(Integer.parseInt(s.trim()));
+    }
+
+    private static void run(int bookings) throws Exception {
+        Path walDir = Files.createTempDirectory("startup-wal");
+        Path snapDir = Files.createTempDirectory("startup-snap");
+
+        FacilityStore store = new FacilityStore();
+        WriteAheadLog wal = new WriteAheadLog(walDir, 0, WriteAheadLog.DEFAULT_BATCH_BYTES);
+        wal.start();
+        ReservationLogic logic = new ReservationLogic(store, wal);
+        ChangeSet changes = new ChangeSet();
+        for (int n = 0; n < bookings; n++) {
+            changes.clear();
+            logic.book("S-" + n / SLOTS, "user" + n % 97, n % SLOTS * 5, n % SLOTS * 5 + 5, changes);
+        }
+        CountDownLatch durable = new CountDownLatch(1);
+        wal.whenDurable(wal.lastLsn(), durable::countDown);
+        durable.await();
+        new Snapshot(snapDir, store, wal).write();
+
+        FacilityStore replayed = new FacilityStore();   // log only
+        long t0 = System.nanoTime();
+        new WriteAheadLog(walDir, 0, WriteAheadLog.DEFAULT_BATCH_BYTES)
+                .recover((lsn, body) -> WalRecord.apply(body, replayed));
+        double replayMs = (System.nanoTime() - t0) / 1e6;
+
+        FacilityStore loaded = new FacilityStore();     // snapshot + log tail
+        WriteAheadLog tail = new WriteAheadLog(walDir, 0, WriteAheadLog.DEFAULT_BATCH_BYTES);
+        t0 = System.nanoTime();
+        Snapshot.Loaded image = new Snapshot(snapDir, loaded, tail).load();
+        tail.recover(image.lsn, (lsn, body) -> {
+            if (!image.covers(lsn, body, loaded)) WalRecord.apply(body, loaded);
+        });
+        double snapshotMs = (System.nanoTime() - t0) / 1e6;
+
+        System.out.printf("%8d  %6.1f  %11.1f  %9.1f  %11.1f%n", bookings,
+                size(walDir) / 1e6, size(snapDir) / 1e6, replayMs, snapshotMs);
+    }
+
+    private static long size(Path dir) throws IOException {
+        try (Stream<Path> files = Files.list(dir)) {
+            return files.mapToLong(p -> p.toFile().length()).sum();
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * WorkerScalingBench.java
+ * Purpose: Measures server throughput versus the number of receive workers.
+ * Design notes:
+ * - Starts an in-process server (see ServerMain.bindChannels/startWorkers) on an ephemeral
+ *   port for each worker count, then drives it with closed-loop UDP clients.
+ * - Each client thread owns its own socket so SO_REUSEPORT hashing spreads the flows.
+ * - Mix is 90% QUERY_AVAIL / 10% BOOK over a handful of facilities.
+ * Usage: java -cp bin WorkerScalingBench [--clients 16] [--seconds 3] [--workers 1,2,4,8]
+ */
+
+import java.net.*;
+import java.nio.ByteBuffer;
+import java.nio.channels.DatagramChannel;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicLong;
+
+public class WorkerScalingBench {
+    public static void main(String[] args) throws Exception {
+        int clients = 16;                                 // closed-loop client threads
+        int seconds = 3;                                  // measurement time per run
+        String workerList = "1,2,4,8";                    // worker counts to sweep
+        for (int i = 0; i < args.length; i++) {
+            switch (args[i]) {
+                case "--clients": clients = Integer.parseInt(args[++i]); break;
+                case "--seconds": seconds = Integer.parseInt(args[++i]); break;
+                case "--workers": workerList = args[++i]; break;
+            }
+        }
+
+        System.out.println("workers  sockets  clients  req/s");
+        for (String w : workerList.split(",")) {
+            int workers = Integer.parseInt(w.trim());
+            FacilityStore store = new FacilityStore();
+            ReservationLogic logic = new ReservationLogic(store);
+            MonitorRegistry monitors = new MonitorRegistry();
+            RequestRouter router = new RequestRouter(logic, monitors, 60_000);
+            List<DatagramChannel> channels = ServerMain.bindChannels(new InetSocketAddress("127.0.0.1", 0), workers);
+            CallbackFanout fanout = new CallbackFanout(router, monitors, channels.get(0).socket(), 0.0, 4096);
+            fanout.start(1);
+            ServerMain.startWorkers(channels, workers, router, fanout, null, 0.0, null);
+            int port = ((InetSocketAddress) channels.get(0).getLocalAddress()).getPort();
+
+            double rate = drive(port, clients, seconds);
+            System.out.printf("%7d  %7d  %7d  %.0f%n", workers, channels.size(), clients, rate);
+            for (DatagramChannel ch : channels) ch.close();   // stops the workers
+        }
+    }
+
+    // Run closed-loop clients for the given time and return completed requests per second
+    private static double drive(int port, int clients, int seconds) throws Exception {
+        AtomicLong completed = new AtomicLong();
+        long deadline = System.nanoTime() + seconds * 1_000_000_000L;
+        Thread[] threads = new Thread[clients];
+        for (int c = 0; c < clients; c++) {
+            final int id = c;
+            threads[c] = new Thread(() -> runClient(id, port, deadline, completed), "bench-client-" + c);
+            threads[c].start();
+        }
+        for (Thread t : threads) t.join();
+        return completed.get() / (double) seconds;
+    }
+
+    private static void runClient(int id, int port, long deadline, AtomicLong completed) {
+        try (DatagramSocket sock = new DatagramSocket()) {
+            sock.setSoTimeout(200);
+            InetAddress server = InetAddress.getLoopbackAddress();
+            byte[] resp = new byte[64 * 1024];
+            long reqId = (long) id << 24;
+            int slot = 0;
+            while (System.nanoTime() < deadline) {
+                byte[] req = (++reqId % 10 == 0)
+                        ? book(reqId, "Room" + (id % 8), slot++ % 1400)
+                        : query(reqId, "Room" + (reqId % 8), (int) (reqId % 7));
+                sock.send(new DatagramPacket(req, req.length, server, port));
+                try {
+                    sock.receive(new DatagramPacket(resp, resp.length));
+                    completed.incrementAndGet();
+                } catch (SocketTimeoutException lost) { /* count only answered requests */ }
+            }
+        } catch (Exception e) {
+            System.out.println("client " + id + " failed: " + e);
+        }
+    }
+
+    private static byte[] query(long reqId, String facility, int day) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 1);
+        header(out, Protocol.OP_QUERY_AVAIL, reqId, out.capacity() - Protocol.HEADER_LEN);
+        WireCodec.writeString(out, facility);
+        out.put((byte) day);
+        return out.array();
+    }
+
+    private static byte[] book(long reqId, String facility, int slot) {
+        ByteBuffer out = WireCodec.newMessageBuffer(2 + facility.length() + 2 + 5 + 6);
+        header(out, Protocol.OP_BOOK, reqId, out.capacity() - Protocol.HEADER_LEN);
+        WireCodec.writeString(out, facility);
+        WireCodec.writeString(out, "bench");
+        WireCodec.writeWeekMinutes(out, slot * 5);
+        WireCodec.writeWeekMinutes(out, slot * 5 + 5);
+        return out.array();
+    }
+
+    private static void header(ByteBuffer out, int op, long reqId, int payloadLen) {
+        WireCodec.Header h = new WireCodec.Header();
+        h.version = Protocol.VERSION; h.opCode = op; h.requestId = reqId; h.flags = 0; h.payloadLen = payloadLen;
+        WireCodec.writeHeader(out, h);
+    }
+}
@@ -2,15 +2,18 @@
  * client_main.c
  * Purpose: C UDP client for facility booking system. Demonstrates heterogeneous RPC with Java server.
  * Design notes:
- * - Uses Winsock2 on Windows or POSIX sockets on Linux/macOS.
- * - Implements at-least-once retry logic with timeout.
- * - Supports query, book, change, and custom operations.
- * - Manual marshalling with wire_codec functions ensures correct byte order.
+ * - Thin command-line front end over libfbclient (fbclient.h): parses options, opens one
+ *   session, calls the typed API and prints the result.
+ * - The library implements at-least-once retries with an adaptive timeout, matches replies by
+ *   requestId and pipelines bulk operations (book --repeat).
+ * - Uses Winsock2 on Windows or POSIX sockets on Linux/macOS (monitor callback listener).
  */
 
 #define _WIN32_WINNT 0x0600 /* enable inet_pton on Windows */
+#define _POSIX_C_SOURCE 200809L /* clock_gettime, strcasecmp */
 #include "protocol.h"
 #include "wire_codec.h"
+#include "fbclient.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -32,10 +35,10 @@
     #define close closesocket
 #else
     #include <unistd.h>
+    #include <strings.h>  /* strcasecmp */
     #include <sys/socket.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
-    #include <sys/select.h>
     typedef int SOCKET;
     #define INVALID_SOCKET -1
     #define SOCKET_ERROR -1
@@ -48,24 +51,6 @@
 #define DEFAULT_RETRIES 3
 #define MAX_DGRAM_SIZE 65536
 
-/* Global request ID counter (simple monotonic) */
-static uint32_t g_request_id = 0;
-
-/*
- * Initialize request ID with random seed.
- */
-void init_request_id() {
-    srand((unsigned)time(NULL));                         /* seed RNG with current time */
-    g_request_id = (uint32_t)(rand() & 0x3FFFFFFF);      /* start with random value */
-}
-
-/*
- * Get next request ID (monotonic increment).
- */
-uint32_t next_request_id() {
-    return ++g_request_id;                               /* increment and return */
-}
-
 /*
  * Parse day string to Day enum.
  */
@@ -81,425 +66,592 @@ Day parse_day(const char *day_str) {
 }
 
 /*
- * Send UDP datagram and wait for response with timeout and retries.
- * Returns number of bytes received, or -1 on failure after all retries.
+ * Monotonic clock in milliseconds (bulk timing).
  */
-int udp_invoke(SOCKET sock, const struct sockaddr_in *server_addr,
-               const uint8_t *request, size_t req_len,
-               uint8_t *response, size_t resp_max,
-               int timeout_ms, int max_retries) {
-    for (int attempt = 0; attempt <= max_retries; attempt++) {
-        /* Send request datagram */
-        int sent = sendto(sock, (const char*)request, (int)req_len, 0,
-                          (struct sockaddr*)server_addr, sizeof(*server_addr));
-        if (sent < 0) {
-            perror("sendto failed");                     /* log error */
-            continue;                                    /* retry */
-        }
+static uint64_t now_ms(void) {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+#endif
+}
 
-        /* Wait for response with timeout using select */
-        fd_set readfds;                                  /* file descriptor set */
-        FD_ZERO(&readfds);                               /* clear set */
-        FD_SET(sock, &readfds);                          /* add socket to set */
-        struct timeval tv;                               /* timeout value */
-        tv.tv_sec = timeout_ms / 1000;                   /* seconds part */
-        tv.tv_usec = (timeout_ms % 1000) * 1000;         /* microseconds part */
-
-        int sel = select((int)(sock + 1), &readfds, NULL, NULL, &tv); /* wait for readable */
-        if (sel < 0) {
-            perror("select failed");                     /* log error */
-            return -1;                                   /* abort */
-        } else if (sel == 0) {
-            printf("[retry %d/%d] timeout, retrying...\n", attempt + 1, max_retries + 1);
-            continue;                                    /* timeout, retry */
-        }
+/*
+ * Format a WeeklyTime as "Day HH:MM" into out.
+ */
+static const char *format_time(const WeeklyTime *t, char *out, size_t out_len) {
+    snprintf(out, out_len, "%s %02u:%02u", day_to_string(t->day), t->hour, t->minute);
+    return out;
+}
 
-        /* Receive response datagram */
-        struct sockaddr_in from_addr;                    /* sender address */
-        socklen_t from_len = sizeof(from_addr);          /* address length */
-        int recv_len = recvfrom(sock, (char*)response, (int)resp_max, 0,
-                                (struct sockaddr*)&from_addr, &from_len);
-        if (recv_len < 0) {
-            perror("recvfrom failed");                   /* log error */
-            return -1;                                   /* abort */
-        }
-        return recv_len;                                 /* success, return length */
+/*
+ * Print why a call failed: server error detail or transport failure.
+ */
+static void report_failure(const char *what, int rc) {
+    if (rc == FB_ERR_SERVER) {
+        const FbError *err = fb_last_error();            /* server error detail */
+        fprintf(stderr, "Server error response (code %u: %s)\n", err->code, err->message);
+    } else {
+        fprintf(stderr, "%s failed\n", what);            /* timeout or socket error */
+    }
+}
+
+/*
+ * Print availability intervals (query reply or monitor callback).
+ */
+static void print_intervals(const FbAvailability *avail) {
+    for (int i = 0; i < avail->count; i++) {             /* loop intervals */
+        char start_str[32], end_str[32];
+        format_time(&avail->intervals[i].start, start_str, sizeof(start_str));
+        format_time(&avail->intervals[i].end, end_str, sizeof(end_str));
+        printf("  %s - %s\n", start_str, end_str);      /* print interval */
     }
-    fprintf(stderr, "Failed after %d retries\n", max_retries + 1); /* all retries exhausted */
-    return -1;                                           /* failure */
 }
 
 /*
  * Command: query facility availability for a given day of the week.
  * Usage: query --facility LabA --day Monday
  */
-void cmd_query(SOCKET sock, struct sockaddr_in *server_addr, const char *facility,
-               Day day, int timeout_ms, int retries, int at_most_once) {
-    /* Build request payload: string facility + uint8 day */
-    uint8_t req_buf[MAX_DGRAM_SIZE];                     /* request buffer */
-    int offset = HEADER_LEN;                             /* skip header, fill payload first */
-    offset += write_string(req_buf + offset, facility);  /* write facility string */
-    req_buf[offset++] = (uint8_t)day;                    /* write day as uint8 */
-    int payload_len = offset - HEADER_LEN;               /* compute payload length */
-
-    /* Build header */
-    Header hdr;                                          /* header struct */
-    hdr.version = PROTOCOL_VERSION;                      /* set version */
-    hdr.opCode = OP_QUERY_AVAIL;                         /* query op */
-    hdr.requestId = next_request_id();                   /* allocate request id */
-    hdr.flags = at_most_once ? FLAG_AT_MOST_ONCE : 0;    /* set flags */
-    hdr.payloadLen = payload_len;                        /* payload length */
-    write_header(req_buf, &hdr);                         /* write header at offset 0 */
-
-    /* Send request and receive response */
-    uint8_t resp_buf[MAX_DGRAM_SIZE];                    /* response buffer */
-    int resp_len = udp_invoke(sock, server_addr, req_buf, offset, resp_buf, sizeof(resp_buf), timeout_ms, retries);
-    if (resp_len < 0) {
-        fprintf(stderr, "Query failed\n");               /* error */
+void cmd_query(FbSession *session, const char *facility, Day day) {
+    static FbAvailability avail;                         /* large; keep off the stack */
+    int rc = fb_query(session, facility, day, &avail);
+    if (rc != FB_OK) {
+        report_failure("Query", rc);
         return;
     }
+    printf("Available intervals for %s: %u\n", day_to_string(day), avail.count); /* print count */
+    print_intervals(&avail);
+}
 
-    /* Parse response header */
-    Header resp_hdr;                                     /* response header */
-    read_header(resp_buf, &resp_hdr);                    /* read header */
-    if (resp_hdr.opCode & OP_ERROR_MASK) {               /* check error bit */
-        fprintf(stderr, "Server error response\n");      /* error */
+/*
+ * Command: query free intervals over the whole week (or a week range) in one round trip.
+ * Usage: query-week --facility LabA
+ *        query-week --facility LabA --from-day Monday --start-hour 8 --to-day Friday --end-hour 18
+ */
+void cmd_query_week(FbSession *session, const char *facility, const WeeklyTime *from, const WeeklyTime *to) {
+    static FbWeekAvailability avail;                     /* large; keep off the stack */
+    int rc = fb_query_week(session, facility, from, to, &avail);
+    if (rc != FB_OK) {
+        report_failure("Week query", rc);
         return;
     }
+    printf("Available intervals for %s: %u\n", facility, avail.count); /* print count */
+    int shown_day = -1;                                  /* day of the last heading printed */
+    for (int i = 0; i < avail.count; i++) {              /* intervals come in time order */
+        const FbInterval *iv = &avail.intervals[i];
+        if ((int)iv->start.day != shown_day) {
+            shown_day = (int)iv->start.day;
+            printf("%s:\n", day_to_string(iv->start.day)); /* day heading */
+        }
+        printf("  %02u:%02u - %02u:%02u\n", iv->start.hour, iv->start.minute, iv->end.hour, iv->end.minute);
+    }
+}
 
-    /* Parse intervals: uint16 count + [WeeklyTime start, WeeklyTime end]* */
-    int pos = HEADER_LEN;                                /* payload start */
-    uint16_t count;                                      /* intervals count */
-    pos += read_u16(resp_buf + pos, &count);             /* read count */
-    printf("Available intervals for %s: %u\n", day_to_string(day), count); /* print count */
-    for (int i = 0; i < count; i++) {                    /* loop intervals */
-        WeeklyTime start, end;                           /* interval bounds */
-        pos += read_weekly_time(resp_buf + pos, &start); /* read start time */
-        pos += read_weekly_time(resp_buf + pos, &end);   /* read end time */
-        
-        /* Format each time separately to avoid static buffer conflict */
+/*
+ * Command: find the first free runs that fit a booking of the given length.
+ * Usage: find-free --facility LabA --minutes 90 --count 3
+ *        find-free --facility LabA --minutes 90 --from-day Tuesday --start-hour 8 --to-day Friday --end-hour 18
+ */
+void cmd_find_free(FbSession *session, const char *facility, int minutes, int count,
+                   const WeeklyTime *from, const WeeklyTime *to) {
+    static FbWeekAvailability found;                     /* large; keep off the stack */
+    if (minutes < 1 || minutes > 0xFFFF || count < 1 || count > 0xFFFF) {
+        fprintf(stderr, "find-free needs --minutes and --count between 1 and 65535\n");
+        return;
+    }
+    int rc = fb_find_free(session, facility, (uint16_t)minutes, (uint16_t)count, from, to, &found);
+    if (rc != FB_OK) {
+        report_failure("Find free", rc);
+        return;
+    }
+    printf("Free runs of %d+ minutes for %s: %u\n", minutes, facility, found.count);
+    for (int i = 0; i < found.count; i++) {
         char start_str[32], end_str[32];
-        snprintf(start_str, sizeof(start_str), "%s %02u:%02u", 
-                day_to_string(start.day), start.hour, start.minute);
-        snprintf(end_str, sizeof(end_str), "%s %02u:%02u", 
-                day_to_string(end.day), end.hour, end.minute);
-        printf("  %s - %s\n", start_str, end_str); /* print interval */
+        format_time(&found.intervals[i].start, start_str, sizeof(start_str));
+        format_time(&found.intervals[i].end, end_str, sizeof(end_str));
+        printf("  %s - %s\n", start_str, end_str);      /* earliest slot starts at the run start */
     }
 }
 
 /*
- * Command: book a facility.
- * Usage: book --facility LabA --user alice --day Monday --start-hour 9 --start-minute 0 --end-hour 10 --end-minute 30
+ * Command: list facilities free for a whole range.
+ * Usage: find-rooms --day Monday --start-hour 9 --end-hour 10 --end-minute 30 --count 50
+ *        find-rooms --from-day Monday --start-hour 9 --to-day Tuesday --end-hour 12
  */
-void cmd_book(SOCKET sock, struct sockaddr_in *server_addr, const char *facility,
-              const char *user, const WeeklyTime *start, const WeeklyTime *end,
-              int timeout_ms, int retries, int at_most_once) {
-    /* Build request payload: str facility + str user + WeeklyTime start + WeeklyTime end */
-    uint8_t req_buf[MAX_DGRAM_SIZE];                     /* request buffer */
-    int offset = HEADER_LEN;                             /* skip header */
-    offset += write_string(req_buf + offset, facility);  /* facility */
-    offset += write_string(req_buf + offset, user);      /* user */
-    offset += write_weekly_time(req_buf + offset, start); /* start time */
-    offset += write_weekly_time(req_buf + offset, end);   /* end time */
-    int payload_len = offset - HEADER_LEN;               /* payload length */
-
-    /* Build header */
-    Header hdr;                                          /* header */
-    hdr.version = PROTOCOL_VERSION;                      /* version */
-    hdr.opCode = OP_BOOK;                                /* book op */
-    hdr.requestId = next_request_id();                   /* request id */
-    hdr.flags = at_most_once ? FLAG_AT_MOST_ONCE : 0;    /* flags */
-    hdr.payloadLen = payload_len;                        /* payload len */
-    write_header(req_buf, &hdr);                         /* write header */
-
-    /* Send and receive */
-    uint8_t resp_buf[MAX_DGRAM_SIZE];                    /* response buffer */
-    int resp_len = udp_invoke(sock, server_addr, req_buf, offset, resp_buf, sizeof(resp_buf), timeout_ms, retries);
-    if (resp_len < 0) {
-        fprintf(stderr, "Book failed\n");                /* error */
+void cmd_find_rooms(FbSession *session, const WeeklyTime *from, const WeeklyTime *to, int count) {
+    static FbRoomList rooms;                             /* large; keep off the stack */
+    if (count < 1 || count > 0xFFFF) {
+        fprintf(stderr, "find-rooms needs --count between 1 and 65535\n");
         return;
     }
-
-    /* Parse response: i64 bookingId */
-    Header resp_hdr;                                     /* response header */
-    read_header(resp_buf, &resp_hdr);                    /* read header */
-    if (resp_hdr.opCode & OP_ERROR_MASK) {               /* check error */
-        fprintf(stderr, "Server error response\n");      /* error */
+    int rc = fb_find_rooms(session, from, to, (uint16_t)count, &rooms);
+    if (rc != FB_OK) {
+        report_failure("Find rooms", rc);
         return;
     }
+    char start_str[32], end_str[32];
+    format_time(from, start_str, sizeof(start_str));
+    format_time(to, end_str, sizeof(end_str));
+    printf("Facilities free %s - %s: %u%s\n", start_str, end_str, rooms.count,
+           rooms.truncated ? " (more available)" : "");
+    for (int i = 0; i < rooms.count; i++) printf("  %s\n", rooms.names[i]);
+}
+
+/*
+ * Command: book a facility.
+ * Usage: book --facility LabA --user alice --day Monday --start-hour 9 --start-minute 0 --end-hour 10 --end-minute 30
+ */
+void cmd_book(FbSession *session, const char *facility, const char *user,
+              const WeeklyTime *start, const WeeklyTime *end) {
     int64_t booking_id;                                  /* booking id */
-    read_i64(resp_buf + HEADER_LEN, &booking_id);        /* read id */
-    
-    /* Format times separately to avoid static buffer conflict */
+    int rc = fb_book(session, facility, user, start, end, &booking_id);
+    if (rc != FB_OK) {
+        report_failure("Book", rc);
+        return;
+    }
     char start_str[32], end_str[32];
-    snprintf(start_str, sizeof(start_str), "%s %02u:%02u", 
-            day_to_string(start->day), start->hour, start->minute);
-    snprintf(end_str, sizeof(end_str), "%s %02u:%02u", 
-            day_to_string(end->day), end->hour, end->minute);
-    
-    /* Use PRId64 for portable int64 printing */
-    printf("Booking created: id=%" PRId64 " for %s from %s to %s\n", 
+    format_time(start, start_str, sizeof(start_str));
+    format_time(end, end_str, sizeof(end_str));
+    printf("Booking created: id=%" PRId64 " for %s from %s to %s\n",
         (int64_t)booking_id, facility, start_str, end_str); /* print result */
 }
 
 /*
- * Command: increment facility usage counter (non-idempotent custom op).
- * Usage: custom-incr --facility LabA
+ * Command: book N back-to-back slots of the same length with up to W requests in flight.
+ * Usage: book --facility LabA --day Monday --start-hour 9 --end-hour 10 --repeat 8 --window 4
  */
-void cmd_custom_incr(SOCKET sock, struct sockaddr_in *server_addr, const char *facility,
-                     int timeout_ms, int retries, int at_most_once) {
-    /* Build request payload: str facility */
-    uint8_t req_buf[MAX_DGRAM_SIZE];                     /* request buffer */
-    int offset = HEADER_LEN;                             /* skip header */
-    offset += write_string(req_buf + offset, facility);  /* facility */
-    int payload_len = offset - HEADER_LEN;               /* payload length */
-
-    /* Build header */
-    Header hdr;                                          /* header */
-    hdr.version = PROTOCOL_VERSION;                      /* version */
-    hdr.opCode = OP_CUSTOM_NON_IDEMPOTENT;               /* non-idempotent op */
-    hdr.requestId = next_request_id();                   /* request id */
-    hdr.flags = at_most_once ? FLAG_AT_MOST_ONCE : 0;    /* flags */
-    hdr.payloadLen = payload_len;                        /* payload len */
-    write_header(req_buf, &hdr);                         /* write header */
-
-    /* Send and receive */
-    uint8_t resp_buf[MAX_DGRAM_SIZE];                    /* response buffer */
-    int resp_len = udp_invoke(sock, server_addr, req_buf, offset, resp_buf, sizeof(resp_buf), timeout_ms, retries);
-    if (resp_len < 0) {
-        fprintf(stderr, "Usage counter increment failed\n"); /* error */
+void cmd_book_bulk(FbSession *session, const char *facility, const char *user,
+                   const WeeklyTime *start, const WeeklyTime *end, int repeat, int window) {
+    int first = start->day * 1440 + start->hour * 60 + start->minute; /* week minutes */
+    int len = end->day * 1440 + end->hour * 60 + end->minute - first; /* slot length */
+    if (len <= 0) {
+        fprintf(stderr, "End must be after start\n");
+        return;
+    }
+    if (first + repeat * len >= 7 * 1440) repeat = (7 * 1440 - 1 - first) / len; /* last end <= Sunday 23:59 */
+    if (repeat < 1) return;
+
+    FbInterval *slots = malloc((size_t)repeat * sizeof(FbInterval));
+    FbBookResult *results = malloc((size_t)repeat * sizeof(FbBookResult));
+    if (slots == NULL || results == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        free(slots); free(results);
         return;
     }
+    for (int i = 0; i < repeat; i++) {
+        int s = first + i * len, e = s + len;            /* this slot */
+        WeeklyTime ws = { (Day)(s / 1440), (uint8_t)(s % 1440 / 60), (uint8_t)(s % 60) };
+        WeeklyTime we = { (Day)(e / 1440), (uint8_t)(e % 1440 / 60), (uint8_t)(e % 60) };
+        slots[i].start = ws;
+        slots[i].end = we;
+    }
 
-    /* Parse response: i64 counter value */
-    Header resp_hdr;                                     /* response header */
-    read_header(resp_buf, &resp_hdr);                    /* read header */
-    if (resp_hdr.opCode & OP_ERROR_MASK) {               /* check error */
-        fprintf(stderr, "Server error response\n");      /* error */
+    uint64_t t0 = now_ms();
+    int created = fb_book_many(session, facility, user, slots, repeat, results);
+    uint64_t elapsed = now_ms() - t0;
+    if (created < 0) {                                   /* nothing sent; results not filled */
+        fprintf(stderr, "Bulk book failed: %s\n", created == FB_ERR_NOMEM ? "out of memory" : "bad arguments");
+        free(slots); free(results);
         return;
     }
+
+    for (int i = 0; i < repeat; i++) {
+        char start_str[32];
+        format_time(&slots[i].start, start_str, sizeof(start_str));
+        if (results[i].status == FB_OK) {
+            printf("  [%d] %s: booking id=%" PRId64 "\n", i, start_str, (int64_t)results[i].booking_id);
+        } else if (results[i].status == FB_ERR_SERVER) {
+            printf("  [%d] %s: server error %u\n", i, start_str, results[i].error_code);
+        } else {
+            printf("  [%d] %s: no reply\n", i, start_str);
+        }
+    }
+    printf("Bulk book: %d/%d created for %s in %" PRIu64 " ms (window=%d)\n",
+           created, repeat, facility, elapsed, window);
+    free(slots); free(results);
+}
+
+/*
+ * Command: increment facility usage counter (non-idempotent custom op).
+ * Usage: custom-incr --facility LabA
+ */
+void cmd_custom_incr(FbSession *session, const char *facility) {
     int64_t usage_count;                                 /* usage counter value */
-    read_i64(resp_buf + HEADER_LEN, &usage_count);       /* read usage count */
+    int rc = fb_incr(session, facility, &usage_count);
+    if (rc != FB_OK) {
+        report_failure("Usage counter increment", rc);
+        return;
+    }
     printf("Usage counter for facility=%s => %" PRId64 "\n", facility, (int64_t)usage_count); /* print result */
 }
 
+/* Display name of a request opCode in STATS output */
+static const char *op_label(uint16_t op) {
+    switch (op) {
+    case OP_QUERY_AVAIL: return "query";
+    case OP_BOOK: return "book";
+    case OP_CHANGE_BOOKING: return "change";
+    case OP_MONITOR: return "monitor";
+    case OP_BATCH: return "batch";
+    case OP_QUERY_WEEK: return "query-week";
+    case OP_FIND_FREE: return "find-free";
+    case OP_FIND_ROOMS: return "find-rooms";
+    case OP_STATS: return "stats";
+    case OP_CUSTOM_IDEMPOTENT: return "reset";
+    case OP_CUSTOM_NON_IDEMPOTENT: return "custom-incr";
+    default: return "other";
+    }
+}
+
 /*
- * Command: change booking time.
- * Usage: change --booking-id 1 --offset 60
+ * Command: print the server's per-opcode latency percentiles, request rates and counters.
+ * With --interval N, takes two samples N seconds apart and reports the rate between them.
+ * Usage: stats [--interval 5]
  */
-void cmd_change(SOCKET sock, struct sockaddr_in *server_addr, int64_t booking_id,
-                int offset_minutes, int timeout_ms, int retries, int at_most_once) {
-    /* Build request payload: i64 bookingId + u32 offsetMinutes */
-    uint8_t req_buf[MAX_DGRAM_SIZE];                     /* request buffer */
-    int offset = HEADER_LEN;                             /* skip header */
-    write_i64(req_buf + offset, booking_id);             /* booking id */
-    offset += 8;                                         /* advance */
-    write_u32(req_buf + offset, (uint32_t)offset_minutes); /* offset minutes */
-    offset += 4;                                         /* advance */
-    int payload_len = offset - HEADER_LEN;               /* payload length */
-
-    /* Build header */
-    Header hdr;                                          /* header */
-    hdr.version = PROTOCOL_VERSION;                      /* version */
-    hdr.opCode = OP_CHANGE_BOOKING;                      /* change booking op */
-    hdr.requestId = next_request_id();                   /* request id */
-    hdr.flags = at_most_once ? FLAG_AT_MOST_ONCE : 0;    /* flags */
-    hdr.payloadLen = payload_len;                        /* payload len */
-    write_header(req_buf, &hdr);                         /* write header */
-
-    /* Send and receive */
-    uint8_t resp_buf[MAX_DGRAM_SIZE];                    /* response buffer */
-    int resp_len = udp_invoke(sock, server_addr, req_buf, offset, resp_buf, sizeof(resp_buf), timeout_ms, retries);
-    if (resp_len < 0) {
-        fprintf(stderr, "Change booking failed\n");      /* error */
+void cmd_stats(FbSession *session, int interval) {
+    static FbStats first, stats;                         /* large; keep off the stack */
+    static const char *phases[FB_STATS_PHASES] = {"decode", "logic", "encode", "send"};
+    int rc = fb_stats(session, &stats);
+    if (rc == FB_OK && interval > 0) {
+        first = stats;
+#ifdef _WIN32
+        Sleep((DWORD)interval * 1000);
+#else
+        sleep((unsigned)interval);
+#endif
+        rc = fb_stats(session, &stats);
+    }
+    if (rc != FB_OK) {
+        report_failure("Stats", rc);
         return;
     }
+    double uptime_s = stats.uptime_ns / 1e9;
+    printf("Server uptime %.1f s\n", uptime_s);
+    if (stats.op_count == 0) printf("  (no latency stats: server runs with --latencyStats false or is idle)\n");
+    for (int i = 0; i < stats.op_count; i++) {
+        const FbOpStats *o = &stats.ops[i];
+        double rate = uptime_s > 0 ? o->count / uptime_s : 0;          /* average since start */
+        if (interval > 0) {
+            uint64_t before = 0;
+            for (int j = 0; j < first.op_count; j++) {
+                if (first.ops[j].op == o->op) before = first.ops[j].count;
+            }
+            rate = (o->count - before) / (double)interval;            /* over the interval */
+        }
+        printf("%-12s %10" PRIu64 " req  %10.1f req/s\n", op_label(o->op), o->count, rate);
+        printf("  %-7s %10s %10s %10s %10s %10s  (us)\n", "", "p50", "p90", "p99", "p99.9", "max");
+        for (int ph = 0; ph < FB_STATS_PHASES; ph++) {
+            printf("  %-7s", phases[ph]);
+            for (int q = 0; q < FB_STATS_QUANTILES; q++) printf(" %10.1f", o->ns[ph][q] / 1e3);
+            printf("\n");
+        }
+    }
+    for (int i = 0; i < stats.counter_count; i++) {
+        printf("%-24s %" PRId64 "\n", stats.counters[i].name, stats.counters[i].value);
+    }
+}
 
-    /* Parse response: WeeklyTime start + WeeklyTime end */
-    Header resp_hdr;                                     /* response header */
-    read_header(resp_buf, &resp_hdr);                    /* read header */
-    if (resp_hdr.opCode & OP_ERROR_MASK) {               /* check error */
-        fprintf(stderr, "Server error response\n");      /* error */
+/*
+ * Command: change booking time.
+ * Usage: change --booking-id 1 --offset 60
+ */
+void cmd_change(FbSession *session, int64_t booking_id, int offset_minutes) {
+    FbInterval updated;                                  /* new time range */
+    int rc = fb_change(session, booking_id, offset_minutes, &updated);
+    if (rc != FB_OK) {
+        report_failure("Change booking", rc);
         return;
     }
-    WeeklyTime new_start, new_end;                       /* new time range */
-    read_weekly_time(resp_buf + HEADER_LEN, &new_start); /* read start */
-    read_weekly_time(resp_buf + HEADER_LEN + 3, &new_end); /* read end */
-    
-    /* Format times separately to avoid static buffer conflict */
     char start_str[32], end_str[32];
-    snprintf(start_str, sizeof(start_str), "%s %02u:%02u", 
-            day_to_string(new_start.day), new_start.hour, new_start.minute);
-    snprintf(end_str, sizeof(end_str), "%s %02u:%02u", 
-            day_to_string(new_end.day), new_end.hour, new_end.minute);
-    
+    format_time(&updated.start, start_str, sizeof(start_str));
+    format_time(&updated.end, end_str, sizeof(end_str));
     printf("Booking changed: new time %s to %s\n", start_str, end_str); /* print result */
 }
 
 /*
- * Command: register monitor for facility changes.
+ * Command: register monitor for facility changes, then print callbacks until interrupted.
  * Usage: monitor --facility LabA --duration 30 --callback-port 10000
  */
-void cmd_monitor(SOCKET sock, struct sockaddr_in *server_addr, const char *facility,
-                 uint32_t duration_seconds, uint32_t callback_port,
-                 int timeout_ms, int retries, int at_most_once) {
-    /* Build request payload: str facility + u32 windowSeconds + u32 callbackPort */
-    uint8_t req_buf[MAX_DGRAM_SIZE];                     /* request buffer */
-    int offset = HEADER_LEN;                             /* skip header */
-    offset += write_string(req_buf + offset, facility);  /* facility */
-    write_u32(req_buf + offset, duration_seconds);       /* window seconds */
-    offset += 4;                                         /* advance */
-    write_u32(req_buf + offset, callback_port);          /* callback port */
-    offset += 4;                                         /* advance */
-    int payload_len = offset - HEADER_LEN;               /* payload length */
-
-    /* Build header */
-    Header hdr;                                          /* header */
-    hdr.version = PROTOCOL_VERSION;                      /* version */
-    hdr.opCode = OP_MONITOR;                             /* monitor op */
-    hdr.requestId = next_request_id();                   /* request id */
-    hdr.flags = at_most_once ? FLAG_AT_MOST_ONCE : 0;    /* flags */
-    hdr.payloadLen = payload_len;                        /* payload len */
-    write_header(req_buf, &hdr);                         /* write header */
-
-    /* Send and receive */
-    uint8_t resp_buf[MAX_DGRAM_SIZE];                    /* response buffer */
-    int resp_len = udp_invoke(sock, server_addr, req_buf, offset, resp_buf, sizeof(resp_buf), timeout_ms, retries);
-    if (resp_len < 0) {
-        fprintf(stderr, "Monitor registration failed\n"); /* error */
+void cmd_monitor(FbSession *session, const char *facility,
+                 uint32_t duration_seconds, uint32_t callback_port) {
+    int rc = fb_monitor(session, facility, duration_seconds, callback_port);
+    if (rc != FB_OK) {
+        if (rc == FB_ERR_PROTOCOL) fprintf(stderr, "Monitor registration failed (bad reply)\n");
+        else report_failure("Monitor registration", rc);
+        return;
+    }
+    printf("Monitor registered for facility=%s, duration=%u seconds, callback port=%u\n",
+           facility, duration_seconds, callback_port);   /* success */
+    printf("Listening for callbacks on port %u...\n", callback_port);
+
+    /* Now listen for callbacks on the callback port */
+    SOCKET callback_sock = socket(AF_INET, SOCK_DGRAM, 0); /* create callback socket */
+    if (callback_sock == INVALID_SOCKET) {
+        perror("callback socket creation failed");        /* error */
         return;
     }
 
-    /* Parse response: u16 ok */
-    Header resp_hdr;                                     /* response header */
-    read_header(resp_buf, &resp_hdr);                    /* read header */
-    if (resp_hdr.opCode & OP_ERROR_MASK) {               /* check error */
-        fprintf(stderr, "Server error response\n");      /* error */
+    /* Bind to callback port */
+    struct sockaddr_in callback_addr;                    /* callback address */
+    memset(&callback_addr, 0, sizeof(callback_addr));    /* zero out */
+    callback_addr.sin_family = AF_INET;                  /* IPv4 */
+    callback_addr.sin_addr.s_addr = INADDR_ANY;          /* any interface */
+    callback_addr.sin_port = htons(callback_port);       /* callback port */
+
+    if (bind(callback_sock, (struct sockaddr*)&callback_addr, sizeof(callback_addr)) < 0) {
+        perror("callback socket bind failed");           /* error */
+        close(callback_sock);                            /* close socket */
         return;
     }
-    uint16_t ok;                                         /* ok flag */
-    read_u16(resp_buf + HEADER_LEN, &ok);                /* read ok */
-    if (ok == 1) {
-        printf("Monitor registered for facility=%s, duration=%u seconds, callback port=%u\n",
-               facility, duration_seconds, callback_port); /* success */
-        printf("Listening for callbacks on port %u...\n", callback_port);
-        
-        /* Now listen for callbacks on the callback port */
-        SOCKET callback_sock = socket(AF_INET, SOCK_DGRAM, 0); /* create callback socket */
-        if (callback_sock == INVALID_SOCKET) {
-            perror("callback socket creation failed");    /* error */
-            return;
-        }
-        
-        /* Bind to callback port */
-        struct sockaddr_in callback_addr;                /* callback address */
-        memset(&callback_addr, 0, sizeof(callback_addr)); /* zero out */
-        callback_addr.sin_family = AF_INET;              /* IPv4 */
-        callback_addr.sin_addr.s_addr = INADDR_ANY;      /* any interface */
-        callback_addr.sin_port = htons(callback_port);   /* callback port */
-        
-        if (bind(callback_sock, (struct sockaddr*)&callback_addr, sizeof(callback_addr)) < 0) {
-            perror("callback socket bind failed");       /* error */
-            close(callback_sock);                        /* close socket */
-            return;
+
+    printf("Waiting for callbacks (press Ctrl+C to stop)...\n");
+
+    /* Wait for callbacks in a loop */
+    static uint8_t callback_buf[MAX_DGRAM_SIZE];         /* callback buffer */
+    static FbAvailability avail;                         /* decoded callback */
+    while (1) {
+        struct sockaddr_in from_addr;                    /* sender address */
+        socklen_t from_len = sizeof(from_addr);          /* address length */
+
+        int recv_len = recvfrom(callback_sock, (char*)callback_buf, sizeof(callback_buf), 0,
+                                (struct sockaddr*)&from_addr, &from_len);
+        if (recv_len < 0) {
+            perror("recvfrom failed");                   /* error */
+            break;
         }
-        
-        printf("Waiting for callbacks (press Ctrl+C to stop)...\n");
-        
-        /* Wait for callbacks in a loop */
-        while (1) {
-            uint8_t callback_buf[MAX_DGRAM_SIZE];        /* callback buffer */
-            struct sockaddr_in from_addr;                /* sender address */
-            socklen_t from_len = sizeof(from_addr);      /* address length */
-            
-            int recv_len = recvfrom(callback_sock, (char*)callback_buf, sizeof(callback_buf), 0,
-                                    (struct sockaddr*)&from_addr, &from_len);
-            if (recv_len < 0) {
-                perror("recvfrom failed");               /* error */
-                break;
-            }
-            
-            /* Parse callback message */
-            Header cb_hdr;                               /* callback header */
-            read_header(callback_buf, &cb_hdr);          /* read header */
-            
-            printf("\n=== Callback received ===\n");
-            printf("OpCode: 0x%04x, RequestId: %u, Flags: 0x%x\n",
-                   cb_hdr.opCode, cb_hdr.requestId, cb_hdr.flags);
-            
-            /* Parse callback payload (same as QUERY_AVAIL response) */
-            if (cb_hdr.opCode == OP_QUERY_AVAIL) {
-                uint16_t count;                          /* interval count */
-                read_u16(callback_buf + HEADER_LEN, &count); /* read count */
-                Day day = (Day)callback_buf[HEADER_LEN + 2]; /* read day */
-                printf("Facility availability updated for %s: %u intervals\n", 
-                       day_to_string(day), count);
-                
-                int offset_cb = HEADER_LEN + 3;         /* start after count + day */
-                for (int i = 0; i < count; i++) {
-                    WeeklyTime start, end;               /* interval */
-                    offset_cb += read_weekly_time(callback_buf + offset_cb, &start);
-                    offset_cb += read_weekly_time(callback_buf + offset_cb, &end);
-                    
-                    /* Format times separately to avoid static buffer conflict */
-                    char start_str[32], end_str[32];
-                    snprintf(start_str, sizeof(start_str), "%s %02u:%02u", 
-                            day_to_string(start.day), start.hour, start.minute);
-                    snprintf(end_str, sizeof(end_str), "%s %02u:%02u", 
-                            day_to_string(end.day), end.hour, end.minute);
-                    printf("  %s - %s\n", start_str, end_str);
-                }
-            }
-            printf("========================\n");
+
+        /* Parse callback message */
+        Header cb_hdr;                                   /* callback header */
+        if (recv_len < HEADER_LEN) continue;             /* not a protocol message */
+        read_header(callback_buf, &cb_hdr);              /* read header */
+
+        printf("\n=== Callback received ===\n");
+        printf("OpCode: 0x%04x, RequestId: %u, Flags: 0x%x\n",
+               cb_hdr.opCode, cb_hdr.requestId, cb_hdr.flags);
+
+        /* Parse callback payload (same as QUERY_AVAIL response plus day) */
+        if (fb_parse_callback(callback_buf, (size_t)recv_len, &avail) == FB_OK) {
+            printf("Facility availability updated for %s: %u intervals\n",
+                   day_to_string(avail.day), avail.count);
+            print_intervals(&avail);
         }
-        
-        close(callback_sock);                            /* close callback socket */
-    } else {
-        fprintf(stderr, "Monitor registration failed (ok=%u)\n", ok); /* error */
+        printf("========================\n");
     }
+
+    close(callback_sock);                                /* close callback socket */
 }
 
 /*
  * Command: reset facility schedule for a specific day (idempotent custom op).
  * Usage: reset --facility LabA --day Monday
  */
-void cmd_reset(SOCKET sock, struct sockaddr_in *server_addr, const char *facility,
-               Day day, int timeout_ms, int retries, int at_most_once) {
-    /* Build request payload: str facility + uint8 day */
-    uint8_t req_buf[MAX_DGRAM_SIZE];                     /* request buffer */
-    int offset = HEADER_LEN;                             /* skip header */
-    offset += write_string(req_buf + offset, facility);  /* facility */
-    req_buf[offset++] = (uint8_t)day;                    /* day as uint8 */
-    int payload_len = offset - HEADER_LEN;               /* payload length */
-
-    /* Build header */
-    Header hdr;                                          /* header */
-    hdr.version = PROTOCOL_VERSION;                      /* version */
-    hdr.opCode = OP_CUSTOM_IDEMPOTENT;                   /* idempotent op */
-    hdr.requestId = next_request_id();                   /* request id */
-    hdr.flags = at_most_once ? FLAG_AT_MOST_ONCE : 0;    /* flags */
-    hdr.payloadLen = payload_len;                        /* payload len */
-    write_header(req_buf, &hdr);                         /* write header */
-
-    /* Send and receive */
-    uint8_t resp_buf[MAX_DGRAM_SIZE];                    /* response buffer */
-    int resp_len = udp_invoke(sock, server_addr, req_buf, offset, resp_buf, sizeof(resp_buf), timeout_ms, retries);
-    if (resp_len < 0) {
-        fprintf(stderr, "Schedule reset failed\n");      /* error */
+void cmd_reset(FbSession *session, const char *facility, Day day) {
+    uint32_t removed_count;                              /* removed bookings count */
+    int rc = fb_reset(session, facility, day, &removed_count);
+    if (rc != FB_OK) {
+        report_failure("Schedule reset", rc);
         return;
     }
+    printf("Schedule reset for facility=%s on %s: %u booking(s) removed\n",
+           facility, day_to_string(day), removed_count); /* print result */
+}
+
+/*
+ * Batch file support: one sub-request per line, blank lines and '#' comments ignored.
+ *   query <facility> <day>
+ *   book <facility> <user> <day> <HH:MM> <HH:MM>
+ *   change <bookingId> <offsetMinutes>
+ *   reset <facility> <day>
+ *   incr <facility>
+ */
+#define BATCH_LINE_MAX 512                               /* longest accepted line */
+#define BATCH_PAYLOAD_MAX 512                            /* encoded sub-payload bound */
+
+typedef struct {
+    int line_no;                                         /* source line */
+    char text[BATCH_LINE_MAX];                           /* line as written (for output) */
+    uint16_t op;                                         /* sub-request op */
+    uint8_t payload[BATCH_PAYLOAD_MAX];                  /* encoded sub-payload */
+    uint32_t len;                                        /* payload length */
+} BatchLine;
+
+static int parse_hhmm(const char *str, Day day, WeeklyTime *out) {
+    unsigned h, m;
+    if (sscanf(str, "%u:%u", &h, &m) != 2 || h > 23 || m > 59) return 0;
+    out->day = day; out->hour = (uint8_t)h; out->minute = (uint8_t)m;
+    return 1;
+}
+
+/* Encode one batch line; returns 0 if the line is malformed */
+static int encode_batch_line(BatchLine *b) {
+    char verb[16], a1[128], a2[128], a3[32], a4[16], a5[16];
+    int n = sscanf(b->text, "%15s %127s %127s %31s %15s %15s", verb, a1, a2, a3, a4, a5);
+    uint8_t *p = b->payload;
+    int off = 0;
+    if (n >= 3 && (strcmp(verb, "query") == 0 || strcmp(verb, "reset") == 0)) {
+        b->op = strcmp(verb, "query") == 0 ? OP_QUERY_AVAIL : OP_CUSTOM_IDEMPOTENT;
+        off += write_string(p + off, a1);                /* facility */
+        p[off++] = (uint8_t)parse_day(a2);               /* day */
+    } else if (n >= 6 && strcmp(verb, "book") == 0) {
+        Day day = parse_day(a3);
+        WeeklyTime start, end;
+        if (!parse_hhmm(a4, day, &start) || !parse_hhmm(a5, day, &end)) return 0;
+        b->op = OP_BOOK;
+        off += write_string(p + off, a1);                /* facility */
+        off += write_string(p + off, a2);                /* user */
+        off += write_weekly_time(p + off, &start);       /* start time */
+        off += write_weekly_time(p + off, &end);         /* end time */
+    } else if (n >= 3 && strcmp(verb, "change") == 0) {
+        b->op = OP_CHANGE_BOOKING;
+        off += write_i64(p + off, atoll(a1));            /* booking id */
+        off += write_u32(p + off, (uint32_t)atoi(a2));   /* offset minutes */
+    } else if (n >= 2 && strcmp(verb, "incr") == 0) {
+        b->op = OP_CUSTOM_NON_IDEMPOTENT;
+        off += write_string(p + off, a1);                /* facility */
+    } else {
+        return 0;
+    }
+    b->len = (uint32_t)off;
+    return 1;
+}
+
+/* Print one sub-result; returns 1 if the server skipped it because the batch reply was full */
+static int print_batch_reply(const BatchLine *b, const FbBatchReply *r) {
+    printf("[line %d] %s => ", b->line_no, b->text);
+    if (r->status & OP_ERROR_MASK) {
+        uint16_t code = 0;
+        char msg[128] = "";
+        if (r->len >= 2) read_u16(r->payload, &code);
+        if (r->len >= 4) read_string(r->payload + 2, msg, sizeof(msg));
+        if (code == ERR_BATCH_FULL) {
+            printf("deferred\n");                        /* resubmitted in the next batch */
+            return 1;
+        }
+        printf("error %u: %s\n", code, msg);
+        return 0;
+    }
+    char start_str[32], end_str[32];
+    switch (r->status) {
+    case OP_BOOK: {
+        int64_t id;
+        read_i64(r->payload, &id);
+        printf("booking id=%" PRId64 "\n", (int64_t)id);
+        break;
+    }
+    case OP_CHANGE_BOOKING: {
+        WeeklyTime ns, ne;
+        read_weekly_time(r->payload, &ns);
+        read_weekly_time(r->payload + 3, &ne);
+        printf("moved to %s - %s\n", format_time(&ns, start_str, sizeof(start_str)),
+               format_time(&ne, end_str, sizeof(end_str)));
+        break;
+    }
+    case OP_CUSTOM_IDEMPOTENT: {
+        uint32_t removed;
+        read_u32(r->payload, &removed);
+        printf("%u booking(s) removed\n", removed);
+        break;
+    }
+    case OP_CUSTOM_NON_IDEMPOTENT: {
+        int64_t value;
+        read_i64(r->payload, &value);
+        printf("usage counter %" PRId64 "\n", (int64_t)value);
+        break;
+    }
+    case OP_QUERY_AVAIL: {
+        uint16_t count;
+        read_u16(r->payload, &count);
+        printf("%u interval(s)\n", count);
+        for (int i = 0; i < count && 2 + (i + 1) * 6 <= (int)r->len; i++) {
+            WeeklyTime ws, we;
+            read_weekly_time(r->payload + 2 + i * 6, &ws);
+            read_weekly_time(r->payload + 2 + i * 6 + 3, &we);
+            printf("  %s - %s\n", format_time(&ws, start_str, sizeof(start_str)),
+                   format_time(&we, end_str, sizeof(end_str)));
+        }
+        break;
+    }
+    default:
+        printf("ok\n");
+    }
+    return 0;
+}
 
-    /* Parse response: u32 removed count */
-    Header resp_hdr;                                     /* response header */
-    read_header(resp_buf, &resp_hdr);                    /* read header */
-    if (resp_hdr.opCode & OP_ERROR_MASK) {               /* check error */
-        fprintf(stderr, "Server error response\n");      /* error */
+/*
+ * Command: run the sub-requests in a file as OP_BATCH datagrams of up to batch_size items.
+ * Usage: batch --file timetable.txt --batch-size 100
+ */
+void cmd_batch(FbSession *session, const char *path, int batch_size) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror("cannot open batch file");
         return;
     }
-    uint32_t removed_count;                              /* removed bookings count */
-    read_u32(resp_buf + HEADER_LEN, &removed_count);     /* read count */
-    printf("Schedule reset for facility=%s on %s: %u booking(s) removed\n", 
-           facility, day_to_string(day), removed_count); /* print result */
+    int cap = 64, n = 0, line_no = 0;
+    BatchLine *lines = malloc((size_t)cap * sizeof(BatchLine));
+    char buf[BATCH_LINE_MAX];
+    while (lines != NULL && fgets(buf, sizeof(buf), f) != NULL) {
+        line_no++;
+        buf[strcspn(buf, "\r\n")] = '\0';                /* strip newline */
+        char *text = buf + strspn(buf, " \t");           /* skip indentation */
+        if (*text == '\0' || *text == '#') continue;     /* blank or comment */
+        if (n == cap) {
+            BatchLine *grown = realloc(lines, (size_t)cap * 2 * sizeof(BatchLine));
+            if (grown == NULL) { free(lines); lines = NULL; break; }
+            lines = grown; cap *= 2;
+        }
+        BatchLine *b = &lines[n];
+        b->line_no = line_no;
+        snprintf(b->text, sizeof(b->text), "%s", text);
+        if (!encode_batch_line(b)) {
+            fprintf(stderr, "[line %d] cannot parse: %s\n", line_no, text);
+            continue;
+        }
+        n++;
+    }
+    fclose(f);
+    if (lines == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return;
+    }
+    if (batch_size < 1) batch_size = 1;
+
+    static uint8_t reply_buf[MAX_DATAGRAM];              /* batch reply payload */
+    FbBatchItem *items = malloc((size_t)batch_size * sizeof(FbBatchItem));
+    FbBatchReply *replies = malloc((size_t)batch_size * sizeof(FbBatchReply));
+    int done = 0, batches = 0;
+    while (items != NULL && replies != NULL && done < n) {
+        /* Take up to batch_size lines that fit in one datagram */
+        int k = 0;
+        size_t bytes = HEADER_LEN + 2;
+        while (done + k < n && k < batch_size
+               && bytes + BATCH_ITEM_HEADER_LEN + lines[done + k].len <= MAX_DATAGRAM) {
+            items[k].op = lines[done + k].op;
+            items[k].payload = lines[done + k].payload;
+            items[k].len = lines[done + k].len;
+            bytes += BATCH_ITEM_HEADER_LEN + items[k].len;
+            k++;
+        }
+        int rc = fb_batch(session, items, k, replies, reply_buf, sizeof(reply_buf));
+        batches++;
+        if (rc != FB_OK) {
+            report_failure("Batch", rc);
+            break;
+        }
+        int handled = k;
+        for (int i = 0; i < k; i++) {
+            if (print_batch_reply(&lines[done + i], &replies[i])) { handled = i; break; } /* rest deferred */
+        }
+        if (handled == 0) {
+            fprintf(stderr, "Batch reply full before the first item; giving up\n");
+            break;
+        }
+        done += handled;
+    }
+    printf("Batch: %d/%d request(s) completed in %d datagram(s)\n", done, n, batches);
+    free(items); free(replies); free(lines);
 }
 
 /*
@@ -507,7 +659,7 @@ void cmd_reset(SOCKET sock, struct sockaddr_in *server_addr, const char *facilit
  */
 int main(int argc, char *argv[]) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <query|book|change|monitor|reset|custom-incr> [options]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <query|query-week|find-free|find-rooms|book|change|monitor|reset|custom-incr|batch|stats> [options]\n", argv[0]);
         return 1;
     }
 
@@ -527,6 +679,14 @@ int main(int argc, char *argv[]) {
     int offset_minutes = 60;                             /* offset minutes for change */
     uint32_t duration_seconds = 30;                      /* monitor duration */
     uint32_t callback_port = 10000;                      /* callback port for monitor */
+    int repeat = 1;                                      /* bulk book: number of slots */
+    int window = 8;                                      /* bulk book: requests in flight */
+    const char *batch_file = NULL;                       /* batch: input file */
+    int week_range = 0;                                  /* query-week/find-free: --from-day/--to-day given */
+    int find_minutes = 60;                               /* find-free: required length */
+    int find_count = 0;                                  /* find-free/find-rooms: results wanted (0 = default) */
+    int batch_size = 100;                                /* batch: items per datagram */
+    int interval = 0;                                    /* stats: seconds between samples (0 = one) */
 
     /* Simple argument parsing loop */
     for (int i = 2; i < argc; i++) {
@@ -542,6 +702,16 @@ int main(int argc, char *argv[]) {
             day = parse_day(argv[++i]);                  /* set day */
             start_time.day = day;                        /* update start day */
             end_time.day = day;                          /* update end day */
+        } else if (strcmp(argv[i], "--from-day") == 0 && i + 1 < argc) {
+            start_time.day = parse_day(argv[++i]);       /* set range start day */
+            week_range = 1;
+        } else if (strcmp(argv[i], "--to-day") == 0 && i + 1 < argc) {
+            end_time.day = parse_day(argv[++i]);         /* set range end day */
+            week_range = 1;
+        } else if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+            find_minutes = atoi(argv[++i]);              /* set required length */
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            find_count = atoi(argv[++i]);                /* set runs wanted */
         } else if (strcmp(argv[i], "--start-hour") == 0 && i + 1 < argc) {
             start_time.hour = (uint8_t)atoi(argv[++i]);  /* set start hour */
         } else if (strcmp(argv[i], "--start-minute") == 0 && i + 1 < argc) {
@@ -562,68 +732,73 @@ int main(int argc, char *argv[]) {
             timeout_ms = atoi(argv[++i]);                /* set timeout */
         } else if (strcmp(argv[i], "--retries") == 0 && i + 1 < argc) {
             retries = atoi(argv[++i]);                   /* set retries */
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);                    /* set bulk repeat count */
+        } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            batch_file = argv[++i];                      /* set batch file */
+        } else if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);                /* set items per batch */
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = atoi(argv[++i]);                  /* set stats sample interval */
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            window = atoi(argv[++i]);                    /* set requests in flight */
         } else if (strcmp(argv[i], "--atMostOnce") == 0 && i + 1 < argc) {
             at_most_once = atoi(argv[++i]);              /* set at-most-once flag */
         }
     }
 
-    /* Initialize Winsock on Windows */
-#ifdef _WIN32
-    WSADATA wsa_data;                                    /* Winsock data */
-    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {    /* initialize Winsock 2.2 */
-        fprintf(stderr, "WSAStartup failed\n");          /* log error */
-        return 1;
-    }
-#endif
-
-    /* Initialize request ID counter */
-    init_request_id();                                   /* seed RNG and init counter */
-
-    /* Create UDP socket */
-    SOCKET sock = socket(AF_INET, SOCK_DGRAM, 0);        /* create UDP socket */
-    if (sock == INVALID_SOCKET) {
-        perror("socket creation failed");                /* log error */
-#ifdef _WIN32
-        WSACleanup();                                    /* cleanup Winsock */
-#endif
+    /* Open a client session (socket, buffers, retransmission timer) */
+    FbOptions opts = fb_default_options();               /* library defaults */
+    opts.timeout_ms = timeout_ms;                        /* timeout ceiling */
+    opts.retries = retries;                              /* max retransmissions */
+    opts.at_most_once = at_most_once;                    /* at-most-once flag */
+    opts.window = window;                                /* bulk requests in flight */
+    opts.verbose = 1;                                    /* print retry notices */
+    FbSession *session = fb_open(host, port, &opts);
+    if (session == NULL) {
+        fprintf(stderr, "Cannot open session to %s:%d\n", host, port); /* bad address or socket error */
         return 1;
     }
 
-    /* Setup server address */
-    struct sockaddr_in server_addr;                      /* server address struct */
-    memset(&server_addr, 0, sizeof(server_addr));        /* zero out struct */
-    server_addr.sin_family = AF_INET;                    /* IPv4 */
-    server_addr.sin_port = htons(port);                  /* port in network byte order */
-    if (inet_pton(AF_INET, host, &server_addr.sin_addr) <= 0) { /* convert IP string to binary */
-        perror("invalid server address");                /* log error */
-        close(sock);                                     /* close socket */
-#ifdef _WIN32
-        WSACleanup();                                    /* cleanup Winsock */
-#endif
-        return 1;
+    /* query-week and find-free cover the whole week unless a range was given */
+    WeeklyTime range_start = {DAY_MONDAY, 0, 0}, range_end = {DAY_SUNDAY, 23, 59};
+    if (week_range) {
+        range_start = start_time;
+        range_end = end_time;
     }
 
     /* Dispatch command */
     if (strcmp(cmd, "query") == 0) {
-        cmd_query(sock, &server_addr, facility, day, timeout_ms, retries, at_most_once);
+        cmd_query(session, facility, day);
+    } else if (strcmp(cmd, "query-week") == 0) {
+        cmd_query_week(session, facility, &range_start, &range_end);
+    } else if (strcmp(cmd, "find-free") == 0) {
+        cmd_find_free(session, facility, find_minutes, find_count != 0 ? find_count : 1, &range_start, &range_end);
+    } else if (strcmp(cmd, "find-rooms") == 0) {
+        cmd_find_rooms(session, &start_time, &end_time, find_count != 0 ? find_count : 100);
+    } else if (strcmp(cmd, "book") == 0 && repeat > 1) {
+        cmd_book_bulk(session, facility, user, &start_time, &end_time, repeat, window);
     } else if (strcmp(cmd, "book") == 0) {
-        cmd_book(sock, &server_addr, facility, user, &start_time, &end_time, timeout_ms, retries, at_most_once);
+        cmd_book(session, facility, user, &start_time, &end_time);
     } else if (strcmp(cmd, "change") == 0) {
-        cmd_change(sock, &server_addr, booking_id, offset_minutes, timeout_ms, retries, at_most_once);
+        cmd_change(session, booking_id, offset_minutes);
     } else if (strcmp(cmd, "monitor") == 0) {
-        cmd_monitor(sock, &server_addr, facility, duration_seconds, callback_port, timeout_ms, retries, at_most_once);
+        cmd_monitor(session, facility, duration_seconds, callback_port);
     } else if (strcmp(cmd, "reset") == 0) {
-        cmd_reset(sock, &server_addr, facility, day, timeout_ms, retries, at_most_once);
+        cmd_reset(session, facility, day);
+    } else if (strcmp(cmd, "batch") == 0 && batch_file != NULL) {
+        cmd_batch(session, batch_file, batch_size);
+    } else if (strcmp(cmd, "batch") == 0) {
+        fprintf(stderr, "batch needs --file <path>\n");  /* missing input */
     } else if (strcmp(cmd, "custom-incr") == 0) {
-        cmd_custom_incr(sock, &server_addr, facility, timeout_ms, retries, at_most_once);
+        cmd_custom_incr(session, facility);
+    } else if (strcmp(cmd, "stats") == 0) {
+        cmd_stats(session, interval);
     } else {
         fprintf(stderr, "Unknown command: %s\n", cmd);   /* unknown command */
     }
 
     /* Cleanup */
-    close(sock);                                         /* close socket */
-#ifdef _WIN32
-    WSACleanup();                                        /* cleanup Winsock */
-#endif
+    fb_close(session);                                   /* close socket, free buffers */
     return 0;
 }
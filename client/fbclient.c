@@ -0,0 +1,729 @@
+/*
+ * fbclient.c
+ * Purpose: Implementation of the embeddable booking client (see fbclient.h).
+ * Design notes:
+ * - The socket is connect()ed to the server, so only server datagrams are received.
+ * - Windowed request engine: keeps up to W requests outstanding and matches replies by
+ *   requestId; stale or duplicate replies are dropped and each request retransmits on its own
+ *   timer. Single calls use a window of one.
+ * - Retransmission timer per session (RFC 6298 style): SRTT/RTTVAR from replies to requests
+ *   sent once (Karn), RTO = SRTT + 4 * RTTVAR clamped to [RTO_MIN_US, timeout ceiling],
+ *   exponential backoff of the shared RTO once per timeout event (every call's deadline is the
+ *   current RTO) with equal jitter on retries, and a retry budget (each new request earns
+ *   RETRY_BUDGET_RATIO of a token, each retransmission spends one).
+ * - Jitter and the first request id come from a per-session xorshift64* state, so the library
+ *   never reseeds or shares the embedding program's rand().
+ * - All encoding goes through wire_codec; request/reply buffers are allocated once per session.
+ */
+
+#define _WIN32_WINNT 0x0600 /* enable inet_pton on Windows */
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+#include "fbclient.h"
+#include "wire_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+/* Platform-specific socket and mutex headers */
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #ifdef _MSC_VER
+        #pragma comment(lib, "ws2_32.lib")
+    #endif
+    #define close closesocket
+    typedef CRITICAL_SECTION fb_mutex_t;
+    #define fb_mutex_init(m) InitializeCriticalSection(m)
+    #define fb_mutex_destroy(m) DeleteCriticalSection(m)
+    #define fb_mutex_lock(m) EnterCriticalSection(m)
+    #define fb_mutex_unlock(m) LeaveCriticalSection(m)
+#else
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <sys/select.h>
+    typedef int SOCKET;
+    #define INVALID_SOCKET -1
+    typedef pthread_mutex_t fb_mutex_t;
+    #define fb_mutex_init(m) pthread_mutex_init((m), NULL)
+    #define fb_mutex_destroy(m) pthread_mutex_destroy(m)
+    #define fb_mutex_lock(m) pthread_mutex_lock(m)
+    #define fb_mutex_unlock(m) pthread_mutex_unlock(m)
+#endif
+
+#define MAX_DGRAM_SIZE 65536
+#define MAX_NAME_LEN 1024                                /* facility/user names */
+#define BULK_RESP_SIZE 512                               /* per-item reply bytes kept by fb_book_many */
+
+#define RTO_MIN_US 5000                                  /* 5 ms floor */
+#define RTO_INITIAL_US 200000                            /* before the first sample */
+#define RETRY_BUDGET_INITIAL 10.0                        /* tokens at start */
+#define RETRY_BUDGET_MAX 20.0                            /* token cap */
+#define RETRY_BUDGET_RATIO 0.1                           /* tokens earned per new request */
+
+/* Retransmission timer state (microseconds) */
+typedef struct {
+    int have_sample;                                     /* SRTT/RTTVAR valid */
+    double srtt_us;                                      /* smoothed RTT */
+    double rttvar_us;                                    /* RTT variation */
+    double rto_us;                                       /* current RTO (before ceiling) */
+    uint64_t backoff_us;                                 /* time of the last RTO backoff */
+    double retry_tokens;                                 /* retry budget */
+} RttEstimator;
+
+/* One request/reply exchange driven by invoke_window */
+typedef struct {
+    const uint8_t *request;      /* encoded request datagram (header included) */
+    size_t req_len;              /* request length */
+    uint32_t request_id;         /* id the reply must carry */
+    uint8_t *response;           /* reply buffer */
+    size_t resp_max;             /* reply buffer size (longer replies are truncated) */
+    int resp_len;                /* reply length, or -1 if no reply */
+    int attempts;                /* transmissions so far */
+    uint64_t sent_us;            /* last transmission time */
+    uint64_t deadline_us;        /* retransmit time while in flight */
+    int state;                   /* CALL_* */
+} FbCall;
+
+enum { CALL_PENDING, CALL_IN_FLIGHT, CALL_DONE, CALL_FAILED };
+
+struct FbSession {
+    SOCKET sock;                 /* connected UDP socket */
+    FbOptions opts;              /* session options */
+    fb_mutex_t lock;             /* serializes calls on this session */
+    atomic_uint next_id;         /* request id counter */
+    RttEstimator rtt;            /* retransmission timer */
+    uint64_t rng;                /* xorshift64* state for jitter and the first id (never 0) */
+    uint8_t *req_buf;            /* request buffer (MAX_DGRAM_SIZE) */
+    uint8_t *resp_buf;           /* reply buffer (MAX_DGRAM_SIZE) */
+    uint8_t *scratch;            /* receive buffer (MAX_DGRAM_SIZE) */
+};
+
+static _Thread_local FbError t_last_error;               /* detail for FB_ERR_SERVER */
+
+/* ---- Time and retransmission timer ---- */
+
+static uint64_t now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t)((double)t.QuadPart * 1e6 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+#endif
+}
+
+static void rtt_sample(RttEstimator *e, double r_us) {
+    if (!e->have_sample) {
+        e->srtt_us = r_us;                               /* first measurement */
+        e->rttvar_us = r_us / 2;
+        e->have_sample = 1;
+    } else {
+        double err = e->srtt_us - r_us;
+        e->rttvar_us = 0.75 * e->rttvar_us + 0.25 * (err < 0 ? -err : err);
+        e->srtt_us = 0.875 * e->srtt_us + 0.125 * r_us;
+    }
+    e->rto_us = e->srtt_us + 4 * e->rttvar_us;
+    if (e->rto_us < RTO_MIN_US) e->rto_us = RTO_MIN_US;
+}
+
+/* Next value of a session's xorshift64* generator (the embedding program's rand() is left alone) */
+static uint64_t session_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+/* Timeout for transmission number `attempt` (1 = first): the current RTO, capped, jittered on
+ * retries. Backoff lives only in rto_us (doubled once per timeout event by invoke_window), so a
+ * call's retries wait RTO, 2*RTO, 4*RTO, ... and never compound with a per-attempt factor. */
+static uint64_t rtt_timeout_us(const RttEstimator *e, uint64_t *rng, int attempt, uint64_t ceiling_us) {
+    double t = e->rto_us;
+    if (t > (double)ceiling_us) t = (double)ceiling_us;
+    if (attempt > 1) t = t / 2 + (t / 2) * ((double)(session_rand(rng) >> 11) / 9007199254740992.0); /* equal jitter on retries, [0,1) */
+    return (uint64_t)t;
+}
+
+/* ---- Request engine ---- */
+
+static void send_call(FbSession *s, FbCall *c, uint64_t ceiling_us) {
+    send(s->sock, (const char*)c->request, (int)c->req_len, 0); /* errors surface as timeouts */
+    c->attempts++;
+    c->state = CALL_IN_FLIGHT;
+    c->sent_us = now_us();
+    c->deadline_us = c->sent_us + rtt_timeout_us(&s->rtt, &s->rng, c->attempts, ceiling_us);
+}
+
+/*
+ * Keep up to `window` calls outstanding and match replies by requestId. Returns the number
+ * of calls answered (failed calls keep resp_len -1), or FB_ERR_IO on a socket error.
+ * Caller holds s->lock.
+ */
+static int invoke_window(FbSession *s, FbCall *calls, int n, int window) {
+    RttEstimator *rtt = &s->rtt;
+    int timeout_ms = s->opts.timeout_ms > 0 ? s->opts.timeout_ms : 1;
+    uint64_t ceiling_us = (uint64_t)timeout_ms * 1000ULL; /* timeout ceiling */
+    int lo = 0;                                          /* first call not yet finished */
+    int next = 0;                                        /* next call to send */
+    int in_flight = 0;                                   /* calls awaiting a reply */
+    int answered = 0;                                    /* calls with a reply */
+    if (window < 1) window = 1;
+    for (int i = 0; i < n; i++) { calls[i].resp_len = -1; calls[i].attempts = 0; calls[i].state = CALL_PENDING; }
+
+    while (lo < n) {
+        /* Fill the window */
+        while (in_flight < window && next < n) {
+            send_call(s, &calls[next++], ceiling_us);
+            rtt->retry_tokens += RETRY_BUDGET_RATIO;     /* new work earns retry budget */
+            if (rtt->retry_tokens > RETRY_BUDGET_MAX) rtt->retry_tokens = RETRY_BUDGET_MAX;
+            in_flight++;
+        }
+
+        /* Retransmit or give up on calls whose timeout passed; find the earliest deadline */
+        uint64_t now = now_us();
+        uint64_t earliest = UINT64_MAX;
+        for (int i = lo; i < next; i++) {
+            FbCall *c = &calls[i];
+            if (c->state != CALL_IN_FLIGHT) continue;
+            if (c->deadline_us <= now) {
+                if (c->sent_us >= rtt->backoff_us) {     /* once per timeout event, not per call */
+                    rtt->rto_us *= 2;                    /* back off later requests too */
+                    if (rtt->rto_us > (double)ceiling_us) rtt->rto_us = (double)ceiling_us;
+                    rtt->backoff_us = now;               /* calls sent before now share this backoff */
+                }
+                if (c->attempts > s->opts.retries || rtt->retry_tokens < 1.0) {
+                    if (s->opts.verbose) {
+                        fprintf(stderr, "Failed after %d attempt(s)%s (req=%u)\n", c->attempts,
+                                c->attempts > s->opts.retries ? "" : ", retry budget exhausted", c->request_id);
+                    }
+                    c->state = CALL_FAILED;              /* give up on this call */
+                    in_flight--;
+                    continue;
+                }
+                rtt->retry_tokens -= 1.0;                /* spend budget */
+                if (s->opts.verbose) {
+                    printf("[retry %d/%d] timeout after %.1f ms for req=%u, retrying...\n", c->attempts,
+                           s->opts.retries + 1, (double)(now - c->sent_us) / 1000.0, c->request_id);
+                }
+                send_call(s, c, ceiling_us);
+            }
+            if (c->deadline_us < earliest) earliest = c->deadline_us;
+        }
+        while (lo < next && calls[lo].state >= CALL_DONE) lo++; /* skip finished calls */
+        if (in_flight == 0) continue;                    /* refill (or exit when all done) */
+
+        /* Wait for a reply until the earliest retransmission deadline */
+        uint64_t wait_us = earliest > now ? earliest - now : 0;
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(s->sock, &readfds);
+        struct timeval tv;
+        tv.tv_sec = (long)(wait_us / 1000000);
+        tv.tv_usec = (long)(wait_us % 1000000);
+        int sel = select((int)(s->sock + 1), &readfds, NULL, NULL, &tv);
+        if (sel < 0) return FB_ERR_IO;                   /* select failed */
+        if (sel == 0) continue;                          /* deadline reached */
+
+        /* Receive one reply and match it to its call */
+        int recv_len = recv(s->sock, (char*)s->scratch, MAX_DGRAM_SIZE, 0);
+        if (recv_len < 0) continue;                      /* e.g. ICMP port unreachable: keep retrying */
+        if (recv_len < HEADER_LEN) continue;             /* not a protocol message */
+        Header resp_hdr;
+        read_header(s->scratch, &resp_hdr);
+        FbCall *match = NULL;
+        for (int i = lo; i < next; i++) {
+            if (calls[i].state == CALL_IN_FLIGHT && calls[i].request_id == resp_hdr.requestId) { match = &calls[i]; break; }
+        }
+        if (match == NULL) continue;                     /* stale or duplicate reply: drop */
+        if (match->attempts == 1) rtt_sample(rtt, (double)(now_us() - match->sent_us)); /* Karn's rule */
+        size_t keep = (size_t)recv_len < match->resp_max ? (size_t)recv_len : match->resp_max;
+        memcpy(match->response, s->scratch, keep);
+        match->resp_len = (int)keep;
+        match->state = CALL_DONE;
+        in_flight--;
+        answered++;
+    }
+    return answered;
+}
+
+/* Write the request header for op into buf; returns the request id */
+static uint32_t put_header(FbSession *s, uint8_t *buf, uint16_t op, size_t req_len) {
+    Header hdr;
+    hdr.version = PROTOCOL_VERSION;
+    hdr.opCode = op;
+    hdr.requestId = atomic_fetch_add(&s->next_id, 1) + 1; /* unique per session */
+    hdr.flags = s->opts.at_most_once ? FLAG_AT_MOST_ONCE : 0;
+    hdr.payloadLen = (uint32_t)(req_len - HEADER_LEN);
+    write_header(buf, &hdr);
+    return hdr.requestId;
+}
+
+/* Record the server error in the reply for fb_last_error() */
+static int server_error(const uint8_t *resp, int resp_len) {
+    memset(&t_last_error, 0, sizeof(t_last_error));
+    if (resp_len >= HEADER_LEN + 2) read_u16(resp + HEADER_LEN, &t_last_error.code);
+    if (resp_len >= HEADER_LEN + 4) {
+        uint16_t len;
+        read_u16(resp + HEADER_LEN + 2, &len);
+        if (HEADER_LEN + 4 + len <= resp_len && len < sizeof(t_last_error.message)) {
+            read_string(resp + HEADER_LEN + 2, t_last_error.message, sizeof(t_last_error.message));
+        }
+    }
+    return FB_ERR_SERVER;
+}
+
+/*
+ * Send s->req_buf[0..req_len) and wait for its reply in s->resp_buf. Returns FB_OK with
+ * *resp_len >= HEADER_LEN + min_payload, or an error status. Caller holds s->lock.
+ */
+static int invoke(FbSession *s, size_t req_len, int min_payload, int *resp_len) {
+    Header req_hdr;
+    read_header(s->req_buf, &req_hdr);
+    FbCall call;
+    memset(&call, 0, sizeof(call));
+    call.request = s->req_buf; call.req_len = req_len; call.request_id = req_hdr.requestId;
+    call.response = s->resp_buf; call.resp_max = MAX_DGRAM_SIZE;
+    int rc = invoke_window(s, &call, 1, 1);
+    if (rc < 0) return rc;
+    if (call.resp_len < 0) return FB_ERR_TIMEOUT;
+    Header resp_hdr;
+    read_header(s->resp_buf, &resp_hdr);
+    if (resp_hdr.opCode & OP_ERROR_MASK) return server_error(s->resp_buf, call.resp_len);
+    if (call.resp_len < HEADER_LEN + min_payload) return FB_ERR_PROTOCOL;
+    *resp_len = call.resp_len;
+    return FB_OK;
+}
+
+static int name_ok(const char *name) {
+    return name != NULL && strlen(name) < MAX_NAME_LEN;
+}
+
+/* Decode u16 count + [WeeklyTime start, WeeklyTime end]* starting at p (count already known) */
+static int read_intervals(const uint8_t *p, const uint8_t *limit, uint16_t count,
+                          FbInterval *out, int max) {
+    if (count > max || p + (size_t)count * 6 > limit) return FB_ERR_PROTOCOL;
+    for (int i = 0; i < count; i++) {
+        p += read_weekly_time(p, &out[i].start);
+        p += read_weekly_time(p, &out[i].end);
+    }
+    return FB_OK;
+}
+
+/* ---- Public API ---- */
+
+FbOptions fb_default_options(void) {
+    FbOptions o;
+    o.timeout_ms = 500;
+    o.retries = 3;
+    o.at_most_once = 0;
+    o.window = 8;
+    o.verbose = 0;
+    return o;
+}
+
+FbSession *fb_open(const char *host, int port, const FbOptions *opts) {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) return NULL; /* reference counted by Winsock */
+#endif
+    FbSession *s = calloc(1, sizeof(FbSession));
+    if (s == NULL) return NULL;
+    s->opts = opts ? *opts : fb_default_options();
+    s->req_buf = malloc(MAX_DGRAM_SIZE);
+    s->resp_buf = malloc(MAX_DGRAM_SIZE);
+    s->scratch = malloc(MAX_DGRAM_SIZE);
+    s->sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons((uint16_t)port);
+    if (s->req_buf == NULL || s->resp_buf == NULL || s->scratch == NULL || s->sock == INVALID_SOCKET
+            || inet_pton(AF_INET, host, &server_addr.sin_addr) <= 0
+            || connect(s->sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        if (s->sock != INVALID_SOCKET) close(s->sock);
+        free(s->req_buf); free(s->resp_buf); free(s->scratch); free(s);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return NULL;
+    }
+
+    fb_mutex_init(&s->lock);
+    s->rng = ((uint64_t)time(NULL) << 20) ^ now_us() ^ (uint64_t)(uintptr_t)s; /* per-session seed */
+    if (s->rng == 0) s->rng = 88172645463325252ULL;        /* xorshift state must be non-zero */
+    atomic_init(&s->next_id, (unsigned)(session_rand(&s->rng) & 0x3FFFFFFF)); /* random starting request id */
+    s->rtt.rto_us = RTO_INITIAL_US;
+    s->rtt.retry_tokens = RETRY_BUDGET_INITIAL;
+    return s;
+}
+
+void fb_close(FbSession *s) {
+    if (s == NULL) return;
+    close(s->sock);
+    fb_mutex_destroy(&s->lock);
+    free(s->req_buf); free(s->resp_buf); free(s->scratch); free(s);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+/* QUERY_AVAIL: str facility + u8 day -> u16 count + intervals */
+int fb_query(FbSession *s, const char *facility, Day day, FbAvailability *out) {
+    if (!name_ok(facility)) return FB_ERR_ARG;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_string(s->req_buf + offset, facility);
+    s->req_buf[offset++] = (uint8_t)day;
+    put_header(s, s->req_buf, OP_QUERY_AVAIL, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 2, &resp_len);
+    if (rc == FB_OK) {
+        uint16_t count;
+        read_u16(s->resp_buf + HEADER_LEN, &count);
+        out->day = day;
+        rc = read_intervals(s->resp_buf + HEADER_LEN + 2, s->resp_buf + resp_len, count,
+                            out->intervals, FB_MAX_INTERVALS);
+        out->count = rc == FB_OK ? count : 0;
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* QUERY_WEEK: str facility + WeeklyTime from + WeeklyTime to -> u16 count + intervals */
+int fb_query_week(FbSession *s, const char *facility, const WeeklyTime *from, const WeeklyTime *to,
+                  FbWeekAvailability *out) {
+    if (!name_ok(facility)) return FB_ERR_ARG;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_string(s->req_buf + offset, facility);
+    offset += write_weekly_time(s->req_buf + offset, from);
+    offset += write_weekly_time(s->req_buf + offset, to);
+    put_header(s, s->req_buf, OP_QUERY_WEEK, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 2, &resp_len);
+    if (rc == FB_OK) {
+        uint16_t count;
+        read_u16(s->resp_buf + HEADER_LEN, &count);
+        rc = read_intervals(s->resp_buf + HEADER_LEN + 2, s->resp_buf + resp_len, count,
+                            out->intervals, FB_MAX_WEEK_INTERVALS);
+        out->count = rc == FB_OK ? count : 0;
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* FIND_FREE: str facility + u16 minMinutes + u16 maxResults + WeeklyTime from + WeeklyTime to
+ * -> u16 count + intervals */
+int fb_find_free(FbSession *s, const char *facility, uint16_t min_minutes, uint16_t max_results,
+                 const WeeklyTime *from, const WeeklyTime *to, FbWeekAvailability *out) {
+    if (!name_ok(facility)) return FB_ERR_ARG;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_string(s->req_buf + offset, facility);
+    offset += write_u16(s->req_buf + offset, min_minutes);
+    offset += write_u16(s->req_buf + offset, max_results);
+    offset += write_weekly_time(s->req_buf + offset, from);
+    offset += write_weekly_time(s->req_buf + offset, to);
+    put_header(s, s->req_buf, OP_FIND_FREE, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 2, &resp_len);
+    if (rc == FB_OK) {
+        uint16_t count;
+        read_u16(s->resp_buf + HEADER_LEN, &count);
+        rc = read_intervals(s->resp_buf + HEADER_LEN + 2, s->resp_buf + resp_len, count,
+                            out->intervals, FB_MAX_WEEK_INTERVALS);
+        out->count = rc == FB_OK ? count : 0;
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* FIND_ROOMS: WeeklyTime from + WeeklyTime to + u16 maxResults -> u16 count + u8 truncated + str* */
+int fb_find_rooms(FbSession *s, const WeeklyTime *from, const WeeklyTime *to, uint16_t max_results,
+                  FbRoomList *out) {
+    if (max_results > FB_MAX_ROOMS) max_results = FB_MAX_ROOMS;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_weekly_time(s->req_buf + offset, from);
+    offset += write_weekly_time(s->req_buf + offset, to);
+    offset += write_u16(s->req_buf + offset, max_results);
+    put_header(s, s->req_buf, OP_FIND_ROOMS, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 3, &resp_len);
+    if (rc == FB_OK) {
+        const uint8_t *p = s->resp_buf + HEADER_LEN, *limit = s->resp_buf + resp_len;
+        uint16_t count;
+        p += read_u16(p, &count);
+        out->truncated = *p++;
+        size_t used = 0;                                 /* bytes of out->text filled */
+        if (count > max_results) rc = FB_ERR_PROTOCOL;
+        for (int i = 0; rc == FB_OK && i < count; i++) {
+            uint16_t len;
+            if (p + 2 > limit) { rc = FB_ERR_PROTOCOL; break; }
+            read_u16(p, &len);
+            if (p + 2 + len > limit || used + len + 1 > sizeof(out->text)) { rc = FB_ERR_PROTOCOL; break; }
+            memcpy(out->text + used, p + 2, len);
+            out->text[used + len] = '\0';
+            out->names[i] = out->text + used;
+            used += (size_t)len + 1;
+            p += 2 + len;
+        }
+        out->count = rc == FB_OK ? count : 0;
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* BOOK: str facility + str user + WeeklyTime start + WeeklyTime end -> i64 bookingId */
+int fb_book(FbSession *s, const char *facility, const char *user,
+            const WeeklyTime *start, const WeeklyTime *end, int64_t *booking_id) {
+    if (!name_ok(facility) || !name_ok(user)) return FB_ERR_ARG;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_string(s->req_buf + offset, facility);
+    offset += write_string(s->req_buf + offset, user);
+    offset += write_weekly_time(s->req_buf + offset, start);
+    offset += write_weekly_time(s->req_buf + offset, end);
+    put_header(s, s->req_buf, OP_BOOK, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 8, &resp_len);
+    if (rc == FB_OK) read_i64(s->resp_buf + HEADER_LEN, booking_id);
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* CHANGE_BOOKING: i64 bookingId + u32 offsetMinutes -> WeeklyTime start + WeeklyTime end */
+int fb_change(FbSession *s, int64_t booking_id, int32_t offset_minutes, FbInterval *updated) {
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_i64(s->req_buf + offset, booking_id);
+    offset += write_u32(s->req_buf + offset, (uint32_t)offset_minutes);
+    put_header(s, s->req_buf, OP_CHANGE_BOOKING, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 6, &resp_len);
+    if (rc == FB_OK) {
+        read_weekly_time(s->resp_buf + HEADER_LEN, &updated->start);
+        read_weekly_time(s->resp_buf + HEADER_LEN + 3, &updated->end);
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* CUSTOM_IDEMPOTENT (reset day): str facility + u8 day -> u32 removed */
+int fb_reset(FbSession *s, const char *facility, Day day, uint32_t *removed) {
+    if (!name_ok(facility)) return FB_ERR_ARG;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_string(s->req_buf + offset, facility);
+    s->req_buf[offset++] = (uint8_t)day;
+    put_header(s, s->req_buf, OP_CUSTOM_IDEMPOTENT, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 4, &resp_len);
+    if (rc == FB_OK) read_u32(s->resp_buf + HEADER_LEN, removed);
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* CUSTOM_NON_IDEMPOTENT (usage counter): str facility -> i64 value */
+int fb_incr(FbSession *s, const char *facility, int64_t *value) {
+    if (!name_ok(facility)) return FB_ERR_ARG;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_string(s->req_buf + offset, facility);
+    put_header(s, s->req_buf, OP_CUSTOM_NON_IDEMPOTENT, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 8, &resp_len);
+    if (rc == FB_OK) read_i64(s->resp_buf + HEADER_LEN, value);
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/*
+ * STATS: empty -> u64 uptimeNs + u16 rows + [u16 op + u64 count + 4 x 5 x u64 ns]* +
+ * u16 counters + [str name + i64 value]*
+ */
+int fb_stats(FbSession *s, FbStats *out) {
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    put_header(s, s->req_buf, OP_STATS, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 12, &resp_len);
+    if (rc == FB_OK) {
+        const uint8_t *p = s->resp_buf + HEADER_LEN, *limit = s->resp_buf + resp_len;
+        int64_t v;
+        p += read_i64(p, &v);
+        out->uptime_ns = (uint64_t)v;
+        p += read_u16(p, &out->op_count);
+        if (out->op_count > FB_MAX_STATS_OPS) rc = FB_ERR_PROTOCOL;
+        for (int i = 0; rc == FB_OK && i < out->op_count; i++) {
+            FbOpStats *o = &out->ops[i];
+            if (p + 10 + 8 * FB_STATS_PHASES * FB_STATS_QUANTILES > limit) { rc = FB_ERR_PROTOCOL; break; }
+            p += read_u16(p, &o->op);
+            p += read_i64(p, &v);
+            o->count = (uint64_t)v;
+            for (int ph = 0; ph < FB_STATS_PHASES; ph++) {
+                for (int q = 0; q < FB_STATS_QUANTILES; q++) {
+                    p += read_i64(p, &v);
+                    o->ns[ph][q] = (uint64_t)v;
+                }
+            }
+        }
+        out->counter_count = 0;
+        uint16_t n = 0;
+        if (rc == FB_OK && p + 2 <= limit) p += read_u16(p, &n);
+        for (int i = 0; rc == FB_OK && i < n && i < FB_MAX_STATS_COUNTERS; i++) {
+            uint16_t len;
+            if (p + 2 > limit) { rc = FB_ERR_PROTOCOL; break; }
+            read_u16(p, &len);
+            if (p + 2 + len + 8 > limit) { rc = FB_ERR_PROTOCOL; break; }
+            if (len < sizeof(out->counters[i].name)) {
+                read_string(p, out->counters[i].name, sizeof(out->counters[i].name));
+            } else {
+                memcpy(out->counters[i].name, p + 2, sizeof(out->counters[i].name) - 1); /* truncate */
+                out->counters[i].name[sizeof(out->counters[i].name) - 1] = '\0';
+            }
+            p += 2 + len;
+            p += read_i64(p, &out->counters[i].value);
+            out->counter_count++;
+        }
+        if (rc != FB_OK) out->op_count = out->counter_count = 0;
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* MONITOR: str facility + u32 windowSeconds + u32 callbackPort -> u16 ok */
+int fb_monitor(FbSession *s, const char *facility, uint32_t duration_seconds, uint32_t callback_port) {
+    if (!name_ok(facility)) return FB_ERR_ARG;
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_string(s->req_buf + offset, facility);
+    offset += write_u32(s->req_buf + offset, duration_seconds);
+    offset += write_u32(s->req_buf + offset, callback_port);
+    put_header(s, s->req_buf, OP_MONITOR, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 2, &resp_len);
+    if (rc == FB_OK) {
+        uint16_t ok;
+        read_u16(s->resp_buf + HEADER_LEN, &ok);
+        if (ok != 1) rc = FB_ERR_PROTOCOL;
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+int fb_book_many(FbSession *s, const char *facility, const char *user,
+                 const FbInterval *slots, int n, FbBookResult *results) {
+    if (!name_ok(facility) || !name_ok(user)) return FB_ERR_ARG;
+    if (n <= 0) return 0;
+    size_t req_size = (size_t)HEADER_LEN + 4 + strlen(facility) + strlen(user) + 6; /* exact request size */
+    uint8_t *req_bufs = malloc((size_t)n * req_size);
+    uint8_t *resp_bufs = malloc((size_t)n * BULK_RESP_SIZE);
+    FbCall *calls = calloc((size_t)n, sizeof(FbCall));
+    if (req_bufs == NULL || resp_bufs == NULL || calls == NULL) {
+        free(req_bufs); free(resp_bufs); free(calls);
+        return FB_ERR_NOMEM;
+    }
+
+    fb_mutex_lock(&s->lock);
+    for (int i = 0; i < n; i++) {
+        uint8_t *req = req_bufs + (size_t)i * req_size;
+        int offset = HEADER_LEN;
+        offset += write_string(req + offset, facility);
+        offset += write_string(req + offset, user);
+        offset += write_weekly_time(req + offset, &slots[i].start);
+        offset += write_weekly_time(req + offset, &slots[i].end);
+        calls[i].request = req; calls[i].req_len = offset;
+        calls[i].request_id = put_header(s, req, OP_BOOK, offset);
+        calls[i].response = resp_bufs + (size_t)i * BULK_RESP_SIZE; calls[i].resp_max = BULK_RESP_SIZE;
+    }
+    int rc = invoke_window(s, calls, n, s->opts.window);
+    fb_mutex_unlock(&s->lock);
+
+    int created = 0;
+    for (int i = 0; i < n; i++) {
+        FbBookResult *r = &results[i];
+        memset(r, 0, sizeof(*r));
+        if (calls[i].resp_len < 0) { r->status = rc < 0 ? rc : FB_ERR_TIMEOUT; continue; }
+        Header resp_hdr;
+        read_header(calls[i].response, &resp_hdr);
+        if (resp_hdr.opCode & OP_ERROR_MASK) {
+            r->status = FB_ERR_SERVER;
+            if (calls[i].resp_len >= HEADER_LEN + 2) read_u16(calls[i].response + HEADER_LEN, &r->error_code);
+        } else if (calls[i].resp_len < HEADER_LEN + 8) {
+            r->status = FB_ERR_PROTOCOL;
+        } else {
+            read_i64(calls[i].response + HEADER_LEN, &r->booking_id);
+            r->status = FB_OK;
+            created++;
+        }
+    }
+    free(req_bufs); free(resp_bufs); free(calls);
+    return created;
+}
+
+/* BATCH: u16 count + [u16 op + u32 len + sub-payload]* -> u16 count + [u16 status + u32 len + sub-result]* */
+int fb_batch(FbSession *s, const FbBatchItem *items, int n, FbBatchReply *replies,
+             uint8_t *reply_buf, size_t reply_cap) {
+    if (n < 0 || n > 0xFFFF) return FB_ERR_ARG;
+    if (reply_cap < MAX_DATAGRAM - HEADER_LEN) return FB_ERR_ARG; /* checked before anything runs */
+    size_t req_len = HEADER_LEN + 2;
+    for (int i = 0; i < n; i++) req_len += BATCH_ITEM_HEADER_LEN + items[i].len;
+    if (req_len > MAX_DATAGRAM) return FB_ERR_ARG;       /* split into several batches */
+
+    fb_mutex_lock(&s->lock);
+    int offset = HEADER_LEN;
+    offset += write_u16(s->req_buf + offset, (uint16_t)n);
+    for (int i = 0; i < n; i++) {
+        offset += write_batch_item(s->req_buf + offset, items[i].op, items[i].payload, items[i].len);
+    }
+    put_header(s, s->req_buf, OP_BATCH, offset);
+    int resp_len;
+    int rc = invoke(s, offset, 2, &resp_len);
+    if (rc == FB_OK) {
+        size_t payload_len = (size_t)resp_len - HEADER_LEN;
+        if (payload_len > reply_cap) {
+            rc = FB_ERR_PROTOCOL;                        /* larger than any datagram */
+        } else {
+            memcpy(reply_buf, s->resp_buf + HEADER_LEN, payload_len);
+            uint16_t count;
+            size_t pos = (size_t)read_u16(reply_buf, &count);
+            if (count != n) rc = FB_ERR_PROTOCOL;
+            for (int i = 0; rc == FB_OK && i < n; i++) {
+                int used = read_batch_item(reply_buf + pos, payload_len - pos,
+                                           &replies[i].status, &replies[i].len, &replies[i].payload);
+                if (used < 0) rc = FB_ERR_PROTOCOL;      /* truncated item */
+                else pos += (size_t)used;
+            }
+        }
+    }
+    fb_mutex_unlock(&s->lock);
+    return rc;
+}
+
+/* Callback: QUERY_AVAIL header flagged as callback + u16 count + u8 day + intervals */
+int fb_parse_callback(const uint8_t *buf, size_t len, FbAvailability *out) {
+    if (len < HEADER_LEN + 3) return FB_ERR_PROTOCOL;
+    Header hdr;
+    read_header(buf, &hdr);
+    if (hdr.opCode != OP_QUERY_AVAIL || !(hdr.flags & FLAG_IS_CALLBACK)) return FB_ERR_PROTOCOL;
+    uint16_t count;
+    read_u16(buf + HEADER_LEN, &count);
+    out->day = (Day)buf[HEADER_LEN + 2];
+    int rc = read_intervals(buf + HEADER_LEN + 3, buf + len, count, out->intervals, FB_MAX_INTERVALS);
+    out->count = rc == FB_OK ? count : 0;
+    return rc;
+}
+
+const FbError *fb_last_error(void) {
+    return &t_last_error;
+}
@@ -0,0 +1,180 @@
+/*
+ * fbclient.h
+ * Purpose: Embeddable client library for the facility booking server (libfbclient.a).
+ * Design notes:
+ * - An FbSession owns a connected UDP socket, reusable request/reply buffers, the adaptive
+ *   retransmission timer and the request id counter. Open one per server and keep it.
+ * - Every call returns an FbStatus and fills a result struct; nothing is printed unless
+ *   FbOptions.verbose is set (retry notices go to stdout, failures to stderr).
+ * - Thread-safe: calls on one session are serialized by a per-session mutex; request ids come
+ *   from an atomic counter. Use one session per thread for parallel requests.
+ * - Server error replies return FB_ERR_SERVER; fb_last_error() holds the code and message for
+ *   the calling thread.
+ */
+
+#ifndef FBCLIENT_H
+#define FBCLIENT_H
+
+#include "protocol.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* Call status */
+typedef enum {
+    FB_OK = 0,
+    FB_ERR_TIMEOUT = -1,     /* no reply after all retries (or retry budget exhausted) */
+    FB_ERR_IO = -2,          /* socket error */
+    FB_ERR_SERVER = -3,      /* server replied with an error; see fb_last_error() */
+    FB_ERR_PROTOCOL = -4,    /* malformed or truncated reply */
+    FB_ERR_ARG = -5,         /* invalid argument (e.g. name too long) */
+    FB_ERR_NOMEM = -6        /* out of memory; nothing was sent */
+} FbStatus;
+
+/* Session options; start from fb_default_options() */
+typedef struct {
+    int timeout_ms;          /* retransmission timeout ceiling */
+    int retries;             /* max retransmissions per request */
+    int at_most_once;        /* set FLAG_AT_MOST_ONCE on requests */
+    int window;              /* requests in flight for bulk calls */
+    int verbose;             /* print retry/failure notices */
+} FbOptions;
+
+/* Server error detail for FB_ERR_SERVER */
+typedef struct {
+    uint16_t code;           /* ERR_* from protocol.h */
+    char message[128];       /* server-supplied message */
+} FbError;
+
+typedef struct {
+    WeeklyTime start;
+    WeeklyTime end;
+} FbInterval;
+
+#define FB_MAX_INTERVALS 720 /* a day holds at most 720 free runs */
+
+/* Availability for one day (QUERY_AVAIL reply or monitor callback) */
+typedef struct {
+    Day day;
+    uint16_t count;
+    FbInterval intervals[FB_MAX_INTERVALS];
+} FbAvailability;
+
+#define FB_MAX_WEEK_INTERVALS (7 * FB_MAX_INTERVALS)
+
+/* Availability over a week range (QUERY_WEEK reply), in time order and split per day */
+typedef struct {
+    uint16_t count;
+    FbInterval intervals[FB_MAX_WEEK_INTERVALS];
+} FbWeekAvailability;
+
+#define FB_MAX_ROOMS 4096
+
+/* Facilities free over a range (FIND_ROOMS reply); names point into text */
+typedef struct {
+    uint16_t count;
+    int truncated;           /* more facilities matched than were returned */
+    const char *names[FB_MAX_ROOMS];
+    char text[MAX_DATAGRAM]; /* NUL-terminated names back to back */
+} FbRoomList;
+
+#define FB_STATS_PHASES 4     /* decode, logic, encode, send */
+#define FB_STATS_QUANTILES 5  /* p50, p90, p99, p99.9, max */
+#define FB_MAX_STATS_OPS 32
+#define FB_MAX_STATS_COUNTERS 64
+
+/* Latency of one opcode (STATS reply); times in nanoseconds */
+typedef struct {
+    uint16_t op;             /* request opCode (0xFFFF: other) */
+    uint64_t count;          /* requests recorded */
+    uint64_t ns[FB_STATS_PHASES][FB_STATS_QUANTILES];
+} FbOpStats;
+
+/* Server latency histograms and counters (STATS reply) */
+typedef struct {
+    uint64_t uptime_ns;      /* since the server started recording */
+    uint16_t op_count;
+    FbOpStats ops[FB_MAX_STATS_OPS];
+    uint16_t counter_count;
+    struct {
+        char name[64];
+        int64_t value;
+    } counters[FB_MAX_STATS_COUNTERS];
+} FbStats;
+
+/* Per-item result of fb_book_many */
+typedef struct {
+    int status;              /* FbStatus */
+    uint16_t error_code;     /* ERR_* when status is FB_ERR_SERVER */
+    int64_t booking_id;      /* valid when status is FB_OK */
+} FbBookResult;
+
+/* One OP_BATCH sub-request: op + encoded sub-payload (same layout as the standalone request) */
+typedef struct {
+    uint16_t op;
+    const uint8_t *payload;
+    uint32_t len;
+} FbBatchItem;
+
+/* One OP_BATCH sub-result: status is the sub-reply opCode (op, or op | OP_ERROR_MASK) */
+typedef struct {
+    uint16_t status;
+    const uint8_t *payload;  /* points into the caller's reply buffer */
+    uint32_t len;
+} FbBatchReply;
+
+typedef struct FbSession FbSession;
+
+FbOptions fb_default_options(void);
+
+/*
+ * Open a session to host:port (IPv4 literal). opts may be NULL for defaults.
+ * Returns NULL on failure.
+ */
+FbSession *fb_open(const char *host, int port, const FbOptions *opts);
+void fb_close(FbSession *s);
+
+int fb_query(FbSession *s, const char *facility, Day day, FbAvailability *out);
+/* Free intervals in [from, to); Monday 00:00 to Sunday 23:59 covers the whole week */
+int fb_query_week(FbSession *s, const char *facility, const WeeklyTime *from, const WeeklyTime *to,
+                  FbWeekAvailability *out);
+/*
+ * First max_results free runs of at least min_minutes inside [from, to), earliest first.
+ * Each run's earliest fitting slot starts at its start time.
+ */
+int fb_find_free(FbSession *s, const char *facility, uint16_t min_minutes, uint16_t max_results,
+                 const WeeklyTime *from, const WeeklyTime *to, FbWeekAvailability *out);
+/* Facilities with nothing booked in [from, to), at most max_results (capped at FB_MAX_ROOMS) */
+int fb_find_rooms(FbSession *s, const WeeklyTime *from, const WeeklyTime *to, uint16_t max_results,
+                  FbRoomList *out);
+int fb_book(FbSession *s, const char *facility, const char *user,
+            const WeeklyTime *start, const WeeklyTime *end, int64_t *booking_id);
+int fb_change(FbSession *s, int64_t booking_id, int32_t offset_minutes, FbInterval *updated);
+int fb_reset(FbSession *s, const char *facility, Day day, uint32_t *removed);
+int fb_incr(FbSession *s, const char *facility, int64_t *value);
+int fb_monitor(FbSession *s, const char *facility, uint32_t duration_seconds, uint32_t callback_port);
+/* Per-opcode latency percentiles and counters; op_count is 0 when the server runs without stats */
+int fb_stats(FbSession *s, FbStats *out);
+
+/*
+ * Book n slots with up to opts.window requests in flight. Fills results[0..n-1] and returns
+ * the number of bookings created, or a negative FbStatus if nothing could be sent.
+ */
+int fb_book_many(FbSession *s, const char *facility, const char *user,
+                 const FbInterval *slots, int n, FbBookResult *results);
+
+/*
+ * Send n sub-requests in one OP_BATCH datagram. The reply payload is copied into reply_buf
+ * (reply_cap bytes, at least MAX_DATAGRAM - HEADER_LEN) and replies[0..n-1] point into it.
+ * Returns FB_OK, FB_ERR_ARG if the request does not fit in one datagram or reply_cap is too
+ * small (both checked before sending, so nothing ran), or a call error.
+ */
+int fb_batch(FbSession *s, const FbBatchItem *items, int n, FbBatchReply *replies,
+             uint8_t *reply_buf, size_t reply_cap);
+
+/* Decode a monitor callback datagram. Returns FB_OK or FB_ERR_PROTOCOL. */
+int fb_parse_callback(const uint8_t *buf, size_t len, FbAvailability *out);
+
+/* Error detail from the calling thread's last FB_ERR_SERVER */
+const FbError *fb_last_error(void);
+
+#endif /* FBCLIENT_H */
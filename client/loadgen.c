@@ -0,0 +1,480 @@
+/*
+ * loadgen.c
+ * Purpose: Load generator for the facility booking server. Drives a configurable mix of
+ *          QUERY_AVAIL/BOOK/CHANGE/reset/custom-incr over N facilities from one process and
+ *          reports throughput and latency percentiles.
+ * Design notes:
+ * - Single thread, one non-blocking UDP socket; requests are matched to replies by requestId.
+ * - Closed loop (--concurrency C): keeps C requests outstanding, issuing one per reply/timeout.
+ * - Open loop (--rate R): issues R requests per second on a fixed schedule regardless of
+ *   replies; latency is measured from the scheduled send time so a stalled server is not hidden.
+ * - No retransmission: a request without a reply after --timeoutMs counts as a timeout.
+ * - Latencies go into a log-bucketed histogram (32 sub-buckets per power of two, ~3% error).
+ * Usage: loadgen [--host 127.0.0.1] [--port 9999] [--duration 10] [--concurrency 8 | --rate 5000]
+ *                [--facilities 8] [--mix query=80,book=10,change=5,reset=1,incr=4]
+ *                [--timeoutMs 1000] [--atMostOnce 0|1]
+ */
+
+#define _WIN32_WINNT 0x0600 /* enable inet_pton on Windows */
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+#include "protocol.h"
+#include "wire_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <inttypes.h> /* PRId64 formatting */
+
+/* Platform-specific socket headers */
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #ifdef _MSC_VER
+        #pragma comment(lib, "ws2_32.lib")
+        #include <intrin.h> /* _BitScanReverse64 */
+    #endif
+    typedef int socklen_t;
+    #define close closesocket
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <sys/select.h>
+    typedef int SOCKET;
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+#endif
+
+/* Default config */
+#define DEFAULT_HOST "127.0.0.1"
+#define DEFAULT_PORT 9999
+#define MAX_DGRAM_SIZE 65536
+#define SLOTS 65536                /* max outstanding requests (power of two) */
+#define MAX_BURST 1024             /* max open-loop sends per loop iteration */
+#define BOOKING_RING 4096          /* booking ids remembered for CHANGE */
+
+/* Operations in the mix */
+enum { MIX_QUERY, MIX_BOOK, MIX_CHANGE, MIX_RESET, MIX_INCR, MIX_OPS };
+static const char *MIX_NAMES[MIX_OPS] = { "query", "book", "change", "reset", "incr" };
+
+/* Outstanding request, indexed by requestId & (SLOTS - 1) */
+typedef struct {
+    int in_use;                    /* waiting for a reply */
+    uint32_t id;                   /* request id */
+    int op;                        /* MIX_* */
+    uint64_t start_ns;             /* scheduled (open loop) or actual send time */
+} Slot;
+
+/* Per-operation counters */
+typedef struct {
+    uint64_t sent, ok, err, timeout;
+} OpStats;
+
+/* ---- Time ---- */
+
+static uint64_t now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* ---- Log-bucketed latency histogram ---- */
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+/* Index of the highest set bit (v != 0) */
+static int msb64(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return (int)idx;
+#else
+    int msb = 0;
+    while (v >>= 1) msb++;
+    return msb;
+#endif
+}
+
+static int hist_index(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;                      /* exact for small values */
+    int msb = msb64(v);                                  /* power of two */
+    int shift = msb - HIST_SUB_BITS;                     /* drop low bits */
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+}
+
+/* Highest value that lands in bucket idx */
+static uint64_t hist_upper(int idx) {
+    if (idx < HIST_SUB) return (uint64_t)idx;
+    int shift = idx / HIST_SUB - 1;
+    uint64_t low = (uint64_t)(HIST_SUB + idx % HIST_SUB) << shift;
+    return low + ((uint64_t)1 << shift) - 1;
+}
+
+static void hist_record(Histogram *h, uint64_t v) {
+    h->counts[hist_index(v)]++;
+    h->total++;
+    if (v > h->max) h->max = v;
+}
+
+/* Value at quantile q (0..1), reported as the bucket's upper bound */
+static uint64_t hist_quantile(const Histogram *h, double q) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)h->total);
+    if (rank >= h->total) rank = h->total - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen > rank) {
+            uint64_t up = hist_upper(i);
+            return up < h->max ? up : h->max;
+        }
+    }
+    return h->max;
+}
+
+/* ---- Random numbers (xorshift64*) ---- */
+
+static uint64_t g_rng = 88172645463325252ULL;
+
+static uint64_t rnd(void) {
+    g_rng ^= g_rng >> 12; g_rng ^= g_rng << 25; g_rng ^= g_rng >> 27;
+    return g_rng * 2685821657736338717ULL;
+}
+
+static int rnd_below(int n) {
+    return (int)(rnd() % (uint64_t)n);
+}
+
+/* ---- Load generator state ---- */
+
+typedef struct {
+    SOCKET sock;
+    struct sockaddr_in server;
+    int facilities;                /* facility count (Fac0..FacN-1) */
+    int mix[MIX_OPS];              /* weights */
+    int mix_total;                 /* sum of weights */
+    uint32_t flags;                /* header flags */
+    uint64_t timeout_ns;           /* reply timeout */
+
+    Slot slots[SLOTS];             /* outstanding requests */
+    uint32_t head;                 /* next request id */
+    uint32_t tail;                 /* oldest id that may still be outstanding */
+    int inflight;                  /* outstanding requests */
+
+    int64_t bookings[BOOKING_RING]; /* recent booking ids for CHANGE */
+    int booking_count;             /* ids stored (capped at BOOKING_RING) */
+    int booking_next;              /* ring write position */
+
+    OpStats ops[MIX_OPS];
+    uint64_t late;                 /* replies after timeout or unknown ids */
+    uint64_t skipped;              /* open-loop sends skipped: too many outstanding */
+    Histogram hist;
+} LoadGen;
+
+static LoadGen g;                  /* large (slots + histogram), keep off the stack */
+
+static int pick_op(void) {
+    int r = rnd_below(g.mix_total);
+    for (int op = 0; op < MIX_OPS; op++) {
+        if (r < g.mix[op]) return op;
+        r -= g.mix[op];
+    }
+    return MIX_QUERY;
+}
+
+/* Encode one request for *op_io into buf (may fall back to BOOK); returns datagram length */
+static int encode_request(uint8_t *buf, int *op_io, uint32_t id) {
+    int op = *op_io;
+    char facility[32];
+    snprintf(facility, sizeof(facility), "Fac%d", rnd_below(g.facilities));
+    Day day = (Day)rnd_below(7);
+    int offset = HEADER_LEN;                             /* skip header, fill payload first */
+    Header hdr;
+    hdr.version = PROTOCOL_VERSION;
+    hdr.requestId = id;
+    hdr.flags = g.flags;
+
+    if (op == MIX_CHANGE && g.booking_count == 0) *op_io = op = MIX_BOOK; /* nothing to change yet */
+    switch (op) {
+    case MIX_BOOK: {
+        int start = 8 * 60 + 5 * rnd_below(144);         /* 08:00..19:55 in 5-minute steps */
+        int len = 30 + 30 * rnd_below(4);                /* 30..120 minutes */
+        WeeklyTime s = { day, (uint8_t)(start / 60), (uint8_t)(start % 60) };
+        WeeklyTime e = { day, (uint8_t)((start + len) / 60), (uint8_t)((start + len) % 60) };
+        hdr.opCode = OP_BOOK;
+        offset += write_string(buf + offset, facility);
+        offset += write_string(buf + offset, "loadgen");
+        offset += write_weekly_time(buf + offset, &s);
+        offset += write_weekly_time(buf + offset, &e);
+        break;
+    }
+    case MIX_CHANGE: {
+        int64_t booking_id = g.bookings[rnd_below(g.booking_count)];
+        int32_t shift = (rnd_below(2) ? 1 : -1) * 5 * (1 + rnd_below(12)); /* +-5..60 minutes */
+        hdr.opCode = OP_CHANGE_BOOKING;
+        offset += write_i64(buf + offset, booking_id);
+        offset += write_u32(buf + offset, (uint32_t)shift);
+        break;
+    }
+    case MIX_RESET:
+        hdr.opCode = OP_CUSTOM_IDEMPOTENT;
+        offset += write_string(buf + offset, facility);
+        buf[offset++] = (uint8_t)day;
+        break;
+    case MIX_INCR:
+        hdr.opCode = OP_CUSTOM_NON_IDEMPOTENT;
+        offset += write_string(buf + offset, facility);
+        break;
+    default:
+        hdr.opCode = OP_QUERY_AVAIL;
+        offset += write_string(buf + offset, facility);
+        buf[offset++] = (uint8_t)day;
+        break;
+    }
+    hdr.payloadLen = (uint32_t)(offset - HEADER_LEN);
+    write_header(buf, &hdr);
+    return offset;
+}
+
+/* Send one request; start_ns is the time latency is measured from. Returns 0 if skipped. */
+static int issue(uint64_t start_ns) {
+    if ((uint32_t)(g.head - g.tail) >= SLOTS) {          /* slot ring full */
+        g.skipped++;
+        return 0;
+    }
+    uint8_t buf[512];
+    uint32_t id = g.head++;
+    int op = pick_op();
+    int len = encode_request(buf, &op, id);
+    Slot *s = &g.slots[id & (SLOTS - 1)];
+    s->in_use = 1; s->id = id; s->op = op; s->start_ns = start_ns;
+    g.inflight++;
+    g.ops[op].sent++;
+    sendto(g.sock, (const char*)buf, len, 0, (struct sockaddr*)&g.server, sizeof(g.server));
+    return 1;                                            /* send errors surface as timeouts */
+}
+
+/* Retire requests that have waited longer than the timeout */
+static void expire(uint64_t now) {
+    while (g.tail != g.head) {
+        Slot *s = &g.slots[g.tail & (SLOTS - 1)];
+        if (s->in_use) {
+            if (now - s->start_ns < g.timeout_ns) break; /* oldest still within timeout */
+            s->in_use = 0;
+            g.inflight--;
+            g.ops[s->op].timeout++;
+        }
+        g.tail++;
+    }
+}
+
+/* Match one reply datagram to its request */
+static void on_reply(const uint8_t *buf, int len, uint64_t now) {
+    if (len < HEADER_LEN) return;
+    Header hdr;
+    read_header(buf, &hdr);
+    if (hdr.flags & FLAG_IS_CALLBACK) return;            /* not a reply */
+    Slot *s = &g.slots[hdr.requestId & (SLOTS - 1)];
+    if ((uint32_t)(hdr.requestId - g.tail) >= (uint32_t)(g.head - g.tail) || !s->in_use || s->id != hdr.requestId) {
+        g.late++;                                        /* timed out already or duplicate */
+        return;
+    }
+    s->in_use = 0;
+    g.inflight--;
+    hist_record(&g.hist, now - s->start_ns);
+    if (hdr.opCode & OP_ERROR_MASK) {
+        g.ops[s->op].err++;                              /* conflicts, missing bookings, ... */
+        return;
+    }
+    g.ops[s->op].ok++;
+    if (hdr.opCode == OP_BOOK && len >= HEADER_LEN + 8) {
+        int64_t booking_id;
+        read_i64(buf + HEADER_LEN, &booking_id);
+        g.bookings[g.booking_next] = booking_id;         /* remember for CHANGE */
+        g.booking_next = (g.booking_next + 1) % BOOKING_RING;
+        if (g.booking_count < BOOKING_RING) g.booking_count++;
+    }
+}
+
+/* Parse "query=80,book=10,..." into g.mix; returns 0 on error */
+static int parse_mix(const char *spec) {
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+    memset(g.mix, 0, sizeof(g.mix));
+    for (char *tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        char *eq = strchr(tok, '=');
+        if (eq == NULL) return 0;
+        *eq = '\0';
+        int op;
+        for (op = 0; op < MIX_OPS; op++) if (strcmp(tok, MIX_NAMES[op]) == 0) break;
+        if (op == MIX_OPS) return 0;
+        g.mix[op] = atoi(eq + 1);
+    }
+    g.mix_total = 0;
+    for (int op = 0; op < MIX_OPS; op++) g.mix_total += g.mix[op];
+    return g.mix_total > 0;
+}
+
+static void set_nonblocking(SOCKET sock) {
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(sock, FIONBIO, &on);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+static void report(double seconds, int rate, int concurrency) {
+    uint64_t sent = 0, ok = 0, err = 0, timeout = 0;
+    for (int op = 0; op < MIX_OPS; op++) {
+        sent += g.ops[op].sent; ok += g.ops[op].ok; err += g.ops[op].err; timeout += g.ops[op].timeout;
+    }
+    if (rate > 0) printf("mode=open-loop rate=%d/s", rate);
+    else printf("mode=closed-loop concurrency=%d", concurrency);
+    printf(" duration=%.1fs facilities=%d\n", seconds, g.facilities);
+    printf("sent=%" PRIu64 " ok=%" PRIu64 " errors=%" PRIu64 " timeouts=%" PRIu64 " late=%" PRIu64 " skipped=%" PRIu64 "\n",
+           sent, ok, err, timeout, g.late, g.skipped);
+    printf("throughput=%.0f replies/s\n", (double)(ok + err) / seconds);
+    printf("latency us: p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+           hist_quantile(&g.hist, 0.50) / 1e3, hist_quantile(&g.hist, 0.90) / 1e3,
+           hist_quantile(&g.hist, 0.99) / 1e3, hist_quantile(&g.hist, 0.999) / 1e3, g.hist.max / 1e3);
+    printf("%-8s %10s %10s %10s %10s\n", "op", "sent", "ok", "errors", "timeouts");
+    for (int op = 0; op < MIX_OPS; op++) {
+        if (g.ops[op].sent == 0) continue;
+        printf("%-8s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n", MIX_NAMES[op],
+               g.ops[op].sent, g.ops[op].ok, g.ops[op].err, g.ops[op].timeout);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = DEFAULT_HOST;                     /* server host */
+    int port = DEFAULT_PORT;                             /* server port */
+    double duration = 10.0;                              /* seconds of load */
+    int rate = 0;                                        /* open-loop requests/s (0 = closed loop) */
+    int concurrency = 8;                                 /* closed-loop outstanding requests */
+    int timeout_ms = 1000;                               /* reply timeout */
+    const char *mix = "query=80,book=10,change=5,reset=1,incr=4";
+    g.facilities = 8;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) duration = atof(argv[++i]);
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rate = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) concurrency = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--facilities") == 0 && i + 1 < argc) g.facilities = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) mix = argv[++i];
+        else if (strcmp(argv[i], "--timeoutMs") == 0 && i + 1 < argc) timeout_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--atMostOnce") == 0 && i + 1 < argc) g.flags = atoi(argv[++i]) ? FLAG_AT_MOST_ONCE : 0;
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!parse_mix(mix)) {
+        fprintf(stderr, "Bad --mix '%s' (ops: query, book, change, reset, incr)\n", mix);
+        return 1;
+    }
+    if (g.facilities < 1) g.facilities = 1;
+    if (concurrency < 1) concurrency = 1;
+    if (concurrency > SLOTS) concurrency = SLOTS;
+    g.timeout_ns = (uint64_t)timeout_ms * 1000000ULL;
+
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        fprintf(stderr, "WSAStartup failed\n");
+        return 1;
+    }
+#endif
+
+    g.sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (g.sock == INVALID_SOCKET) {
+        perror("socket creation failed");
+        return 1;
+    }
+    int rcvbuf = 4 * 1024 * 1024;                        /* absorb reply bursts */
+    setsockopt(g.sock, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+    set_nonblocking(g.sock);
+    memset(&g.server, 0, sizeof(g.server));
+    g.server.sin_family = AF_INET;
+    g.server.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &g.server.sin_addr) <= 0) {
+        perror("invalid server address");
+        close(g.sock);
+        return 1;
+    }
+
+    g_rng ^= (uint64_t)time(NULL);                       /* vary the mix between runs */
+    g.head = g.tail = (uint32_t)(rnd() & 0x3FFFFFFF);    /* random starting request id */
+
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)(duration * 1e9);
+    uint64_t interval = rate > 0 ? 1000000000ULL / (uint64_t)rate : 0; /* open-loop spacing */
+    uint64_t next_send = start;
+    static uint8_t buf[MAX_DGRAM_SIZE];
+
+    for (;;) {
+        uint64_t now = now_ns();
+        if (now >= end && (g.inflight == 0 || now >= end + g.timeout_ns)) break; /* drained */
+
+        /* Issue new requests */
+        if (now < end) {
+            if (rate > 0) {
+                for (int n = 0; next_send <= now && n < MAX_BURST; n++) {
+                    issue(next_send);                    /* latency counts from the schedule */
+                    next_send += interval;
+                }
+            } else {
+                while (g.inflight < concurrency && issue(now)) ; /* ring full: expire() frees slots */
+            }
+        }
+        expire(now);
+
+        /* Wait for a reply or the next scheduled send (at most 1 ms) */
+        uint64_t wait = 1000000ULL;
+        if (rate > 0 && now < end && next_send > now && next_send - now < wait) wait = next_send - now;
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(g.sock, &readfds);
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = (long)(wait / 1000);
+        if (select((int)(g.sock + 1), &readfds, NULL, NULL, &tv) <= 0) continue;
+
+        /* Drain every reply that is ready */
+        for (;;) {
+            int n = recvfrom(g.sock, (char*)buf, sizeof(buf), 0, NULL, NULL);
+            if (n < 0) break;                            /* would block (or transient error) */
+            on_reply(buf, n, now_ns());
+        }
+    }
+    expire(UINT64_MAX);                                  /* anything left is a timeout */
+
+    report(duration, rate, concurrency);                 /* throughput over the load phase */
+    close(g.sock);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
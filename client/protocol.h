@@ -17,10 +17,15 @@
 #define PROTOCOL_VERSION 1
 
 /* Op codes (uint16 on wire) */
-#define OP_QUERY_AVAIL          0x0001
+#define OP_QUERY_AVAIL          0x0001  /* free runs of one day; overnight bookings block both days */
 #define OP_BOOK                 0x0002
 #define OP_CHANGE_BOOKING       0x0003
 #define OP_MONITOR              0x0004
+#define OP_BATCH                0x0005  /* many sub-requests in one datagram */
+#define OP_QUERY_WEEK           0x0006  /* free intervals over a week-minute range */
+#define OP_FIND_FREE            0x0007  /* first free runs of a minimum length */
+#define OP_FIND_ROOMS           0x0008  /* facilities free over a whole range */
+#define OP_STATS                0x0009  /* per-opcode latency percentiles + counters */
 #define OP_CUSTOM_IDEMPOTENT    0x1001  /* set facility color */
 #define OP_CUSTOM_NON_IDEMPOTENT 0x1002 /* increment counter */
 
@@ -32,6 +37,7 @@
 #define ERR_NOT_FOUND           2
 #define ERR_BAD_REQUEST         3
 #define ERR_INTERNAL            4
+#define ERR_BATCH_FULL          5   /* batch item not run (reply full): resubmit it */
 
 /* Flags (uint32 bits) */
 #define FLAG_AT_MOST_ONCE       (1U << 0)
@@ -40,6 +46,16 @@
 /* Header length in bytes */
 #define HEADER_LEN              16
 
+/* Largest UDP payload over IPv4 */
+#define MAX_DATAGRAM            65507
+
+/*
+ * OP_BATCH payload: uint16 count + [uint16 opCode + uint32 len + sub-payload]*.
+ * Reply payload:   uint16 count + [uint16 status + uint32 len + sub-result]*, where status is the
+ * sub-request's reply opCode (op, or op | OP_ERROR_MASK with uint16 errCode + string message).
+ */
+#define BATCH_ITEM_HEADER_LEN   6
+
 /* Day enumeration for weekly schedule (matches Java) */
 typedef enum {
     DAY_MONDAY = 0,
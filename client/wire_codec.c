@@ -129,6 +129,26 @@ int read_weekly_time(const uint8_t *buf, WeeklyTime *time) {
     return 3;                                            /* bytes read */
 }
 
+/* Write one batch item: uint16 op + uint32 len + payload */
+int write_batch_item(uint8_t *buf, uint16_t op, const uint8_t *payload, uint32_t len) {
+    int offset = 0;                                      /* current write position */
+    offset += write_u16(buf + offset, op);               /* sub-request op (or reply status) */
+    offset += write_u32(buf + offset, len);              /* sub-payload length */
+    memcpy(buf + offset, payload, len);                  /* sub-payload bytes */
+    return offset + (int)len;                            /* total bytes written */
+}
+
+/* Read one batch item; payload points into buf */
+int read_batch_item(const uint8_t *buf, size_t avail, uint16_t *op, uint32_t *len, const uint8_t **payload) {
+    if (avail < BATCH_ITEM_HEADER_LEN) return -1;        /* truncated item header */
+    int offset = 0;                                      /* read position */
+    offset += read_u16(buf + offset, op);                /* op or status */
+    offset += read_u32(buf + offset, len);               /* sub-payload length */
+    if (*len > avail - BATCH_ITEM_HEADER_LEN) return -1; /* truncated sub-payload */
+    *payload = buf + offset;                             /* sub-payload view */
+    return offset + (int)*len;                           /* total bytes consumed */
+}
+
 /* Helper: get day name from Day enum */
 const char* day_to_string(Day day) {
     switch (day) {
@@ -88,6 +88,18 @@ int write_weekly_time(uint8_t *buf, const WeeklyTime *time);
  */
 int read_weekly_time(const uint8_t *buf, WeeklyTime *time);
 
+/*
+ * Write one batch item: uint16 op + uint32 len + len payload bytes.
+ * Returns total bytes written (6 + len).
+ */
+int write_batch_item(uint8_t *buf, uint16_t op, const uint8_t *payload, uint32_t len);
+
+/*
+ * Read one batch item from buf (avail bytes left). Sets *op, *len and *payload (pointing into buf).
+ * Returns total bytes consumed (6 + len), or -1 if the item is truncated.
+ */
+int read_batch_item(const uint8_t *buf, size_t avail, uint16_t *op, uint32_t *len, const uint8_t **payload);
+
 /*
  * Helper: convert WeeklyTime to string for display.
  * Returns pointer to static buffer (not thread-safe).
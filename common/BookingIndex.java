@@ -0,0 +1,93 @@
+/*
+ * BookingIndex.java
+ * Purpose: Sorted per-facility index of bookings keyed by start week-minute.
+ * Design notes:
+ * - Bookings of one facility never overlap and have positive length, so ordering by start also
+ *   orders by end. Conflict checks use the facility's OccupancyBitmap, not this index; the index
+ *   serves ordered listing, per-day resets and snapshots.
+ * - Parallel arrays (starts, ends, items) keep binary searches on primitive ints copied from the
+ *   booking at insert time, so lookups never dereference a Booking.
+ * - lowerBound() is O(log n); add/remove shift the arrays (memmove). Snapshot loading hands
+ *   over whole arrays (load) instead of adding bookings one by one.
+ * - A booking must be removed before its start/end are mutated and re-added afterwards.
+ * - Not thread-safe; callers hold the owning facility's lock.
+ */
+
+import java.util.List;
+import java.util.ArrayList;
+import java.util.Arrays;
+
+public final class BookingIndex {
+    private int[] starts = new int[8];                  // start week-minute per slot, ascending
+    private int[] ends = new int[8];                    // end week-minute per slot, ascending
+    private Types.Booking[] items = new Types.Booking[8]; // booking per slot
+    private int size;                                   // number of bookings held
+
+    public int size() { return size; }
+    public Types.Booking get(int i) { return items[i]; }
+    public int startAt(int i) { return starts[i]; }
+    public int endAt(int i) { return ends[i]; }
+
+    // First slot whose start >= minute (size if none)
+    public int lowerBound(int minute) {
+        int lo = 0, hi = size;                          // search [lo, hi)
+        while (lo < hi) {
+            int mid = (lo + hi) >>> 1;
+            if (starts[mid] < minute) lo = mid + 1; else hi = mid;
+        }
+        return lo;
+    }
+
+    // Insert booking at its sorted position
+    public void add(Types.Booking b) {
+        int s = b.start;                                // copy week minutes into the arrays
+        int e = b.end;
+        if (size == items.length) grow();
+        int i = lowerBound(s);                          // insertion point
+        int tail = size - i;                            // slots to shift right
+        System.arraycopy(starts, i, starts, i + 1, tail);
+        System.arraycopy(ends, i, ends, i + 1, tail);
+        System.arraycopy(items, i, items, i + 1, tail);
+        starts[i] = s; ends[i] = e; items[i] = b;
+        size++;
+    }
+
+    // Remove booking (located by its current start); returns false if absent
+    public boolean remove(Types.Booking b) {
+        int s = b.start;
+        for (int i = lowerBound(s); i < size && starts[i] == s; i++) {
+            if (items[i] == b) { removeRange(i, i + 1); return true; }
+        }
+        return false;
+    }
+
+    // Remove slots [from, to)
+    public void removeRange(int from, int to) {
+        int tail = size - to;                           // slots to shift left
+        System.arraycopy(starts, to, starts, from, tail);
+        System.arraycopy(ends, to, ends, from, tail);
+        System.arraycopy(items, to, items, from, tail);
+        int newSize = size - (to - from);
+        Arrays.fill(items, newSize, size, null);        // drop references for GC
+        size = newSize;
+    }
+
+    // Replace the contents with n bookings already in start order (snapshot load); the arrays are
+    // taken over, not copied, and must be at least max(n, 1) long
+    public void load(int[] starts, int[] ends, Types.Booking[] items, int n) {
+        this.starts = starts; this.ends = ends; this.items = items;
+        this.size = n;
+    }
+
+    // Copy of all bookings in start order
+    public List<Types.Booking> toList() {
+        return new ArrayList<>(Arrays.asList(items).subList(0, size));
+    }
+
+    private void grow() {
+        int cap = items.length * 2;
+        starts = Arrays.copyOf(starts, cap);
+        ends = Arrays.copyOf(ends, cap);
+        items = Arrays.copyOf(items, cap);
+    }
+}
@@ -0,0 +1,121 @@
+/*
+ * FreeRunTree.java
+ * Purpose: Segment tree over an OccupancyBitmap answering "first free run of at least len minutes
+ *          at or after a given minute" without scanning the week.
+ * Design notes:
+ * - Leaves are the bitmap's 64-minute words (158, padded to 256); each node stores the free
+ *   minutes at its left edge (pre), at its right edge (suf) and its longest free run (best).
+ * - The bitmap calls refresh() for the words a set/clear touched, so a booking update costs
+ *   O(duration/64 + log n) and the tree always mirrors the bitmap.
+ * - firstFit() walks the O(log n) nodes covering the window left to right, carrying the free run
+ *   that ends at the current node, and descends into a single node once one is known to hold the
+ *   answer. Only the two partial words at the window edges are scanned bit by bit.
+ * - Minute 10079 (Sunday 23:59) and later count as booked: a slot must end by Sunday 23:59,
+ *   the last time a WeeklyTime can express.
+ * - Not thread-safe; callers hold the owning facility's lock (searches only need the read lock).
+ */
+
+public final class FreeRunTree {
+    public static final int LIMIT = OccupancyBitmap.WEEK_MINUTES - 1;  // latest slot end (Sunday 23:59)
+    private static final int WORDS = (OccupancyBitmap.WEEK_MINUTES + 63) >>> 6; // real leaves
+    private static final int LEAVES = 256;                             // leaves padded to a power of two
+
+    private final int[] pre = new int[2 * LEAVES];                     // free minutes at the left edge
+    private final int[] suf = new int[2 * LEAVES];                     // free minutes at the right edge
+    private final int[] best = new int[2 * LEAVES];                    // longest free run in the node
+
+    // Search state: free run ending where the scan has reached, and the answer once found
+    private static final class Scan {
+        int run;                                                       // free minutes just before the scan position
+        int found = -1;                                                // first fitting start minute
+    }
+
+    // Build over the given bitmap words (padding leaves stay fully booked)
+    public FreeRunTree(long[] words) {
+        refresh(words, 0, WORDS - 1);
+    }
+
+    // Recompute leaves w0..w1 and their ancestors after the bitmap changed there
+    public void refresh(long[] words, int w0, int w1) {
+        for (int w = w0; w <= w1; w++) {
+            int n = LEAVES + w;
+            long booked = words[w] | blockedBits(w);                   // minutes past LIMIT never free
+            pre[n] = Long.numberOfTrailingZeros(booked);               // bit i is minute 64w+i
+            suf[n] = Long.numberOfLeadingZeros(booked);
+            best[n] = longestZeroRun(booked);
+        }
+        int span = 64;                                                 // minutes under a child
+        for (int lo = (LEAVES + w0) >>> 1, hi = (LEAVES + w1) >>> 1; lo >= 1; lo >>>= 1, hi >>>= 1, span <<= 1) {
+            for (int n = lo; n <= hi; n++) pull(n, span);
+        }
+    }
+
+    // First minute s >= from with [s, s+len) free and inside [from, to), or -1
+    public int firstFit(long[] words, int from, int to, int len) {
+        to = Math.min(to, LIMIT);
+        if (len <= 0 || from < 0 || to - from < len) return -1;
+        Scan sc = new Scan();
+        visit(words, 1, 0, LEAVES * 64, from, to, len, sc);
+        return sc.found;
+    }
+
+    // Walk the nodes covering [from, to) in minute order
+    private void visit(long[] words, int n, int lo, int hi, int from, int to, int len, Scan sc) {
+        if (sc.found >= 0 || hi <= from || lo >= to) return;          // answered, or outside the window
+        if (from <= lo && hi <= to) {                                  // node fully inside the window
+            scanNode(words, n, lo, hi, len, sc);
+        } else if (n >= LEAVES) {                                      // partial word at a window edge
+            scanBits(words[n - LEAVES] | blockedBits(n - LEAVES), lo, Math.max(lo, from), Math.min(hi, to), len, sc);
+        } else {
+            int mid = (lo + hi) >>> 1;
+            visit(words, 2 * n, lo, mid, from, to, len, sc);
+            visit(words, 2 * n + 1, mid, hi, from, to, len, sc);
+        }
+    }
+
+    // Consume a whole node: fit across its left edge, fit inside it, or carry its right edge on
+    private void scanNode(long[] words, int n, int lo, int hi, int len, Scan sc) {
+        if (sc.run + pre[n] >= len) { sc.found = lo - sc.run; return; } // run from earlier nodes completes here
+        if (best[n] >= len) {                                          // answer lies inside: descend
+            if (n >= LEAVES) {
+                scanBits(words[n - LEAVES] | blockedBits(n - LEAVES), lo, lo, hi, len, sc);
+            } else {
+                int mid = (lo + hi) >>> 1;
+                scanNode(words, 2 * n, lo, mid, len, sc);
+                if (sc.found < 0) scanNode(words, 2 * n + 1, mid, hi, len, sc);
+            }
+            return;
+        }
+        sc.run = pre[n] == hi - lo ? sc.run + (hi - lo) : suf[n];      // fully free extends the run
+    }
+
+    // Scan minutes [a, b) of one word (bit i = minute base+i) for the first fitting start
+    private static void scanBits(long booked, int base, int a, int b, int len, Scan sc) {
+        for (int m = a; m < b; m++) {
+            if ((booked >>> (m - base) & 1L) != 0) { sc.run = 0; continue; }
+            if (++sc.run >= len) { sc.found = m - len + 1; return; }
+        }
+    }
+
+    // Combine the children of node n; span is the width of one child in minutes
+    private void pull(int n, int span) {
+        int l = 2 * n, r = l + 1;
+        pre[n] = pre[l] == span ? span + pre[r] : pre[l];
+        suf[n] = suf[r] == span ? span + suf[l] : suf[r];
+        best[n] = Math.max(Math.max(best[l], best[r]), suf[l] + pre[r]);
+    }
+
+    // Bits of word w at or beyond LIMIT
+    private static long blockedBits(int w) {
+        int first = LIMIT - (w << 6);                                  // bit index of LIMIT in this word
+        return first >= 64 ? 0L : -1L << Math.max(first, 0);
+    }
+
+    // Longest run of zero bits in a word
+    private static int longestZeroRun(long booked) {
+        long free = ~booked;
+        int k = 0;
+        while (free != 0) { free &= free << 1; k++; }                  // each step trims one bit off every run
+        return k;
+    }
+}
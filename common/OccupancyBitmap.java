@@ -0,0 +1,106 @@
+/*
+ * OccupancyBitmap.java
+ * Purpose: One bit per minute of the week marking booked minutes of a facility.
+ * Design notes:
+ * - 10,080 minutes fit in 158 longs (1,264 bytes); bit i covers [i, i+1) in week minutes.
+ * - Range set/clear/test touch only the words covering the range, so a conflict check costs
+ *   at most duration/64 + 2 word operations no matter how many bookings the facility holds.
+ * - nextSet/nextClear skip whole words and use Long.numberOfTrailingZeros inside a word.
+ * - A FreeRunTree over the words is refreshed by every set/clear, so firstFree() finds the first
+ *   long-enough free run in O(log n) however fragmented the week is.
+ * - Snapshots copy and restore the raw words (copyWords/load), rebuilding the tree once.
+ * - Not thread-safe; callers hold the owning facility's lock.
+ */
+
+import java.nio.LongBuffer;
+
+public final class OccupancyBitmap {
+    public static final int WEEK_MINUTES = 7 * 24 * 60;               // number of bits
+    public static final int WORDS = (WEEK_MINUTES + 63) >>> 6;        // 158 words
+    private final long[] words = new long[WORDS];                     // bit i of word w = minute 64w+i
+    private final FreeRunTree runs = new FreeRunTree(words);          // longest free runs over the words
+
+    // Mark minutes [from, to) as booked
+    public void set(int from, int to) {
+        if (from >= to) return;
+        int w0 = from >>> 6, w1 = (to - 1) >>> 6;                      // first and last word touched
+        long first = -1L << from;                                     // bits >= from within w0
+        long last = -1L >>> -to;                                      // bits < to within w1
+        if (w0 == w1) {
+            words[w0] |= first & last;
+        } else {
+            words[w0] |= first;
+            for (int w = w0 + 1; w < w1; w++) words[w] = -1L;         // full words in between
+            words[w1] |= last;
+        }
+        runs.refresh(words, w0, w1);                                  // keep free runs in step
+    }
+
+    // Mark minutes [from, to) as free
+    public void clear(int from, int to) {
+        if (from >= to) return;
+        int w0 = from >>> 6, w1 = (to - 1) >>> 6;
+        long first = -1L << from;
+        long last = -1L >>> -to;
+        if (w0 == w1) {
+            words[w0] &= ~(first & last);
+        } else {
+            words[w0] &= ~first;
+            for (int w = w0 + 1; w < w1; w++) words[w] = 0L;
+            words[w1] &= ~last;
+        }
+        runs.refresh(words, w0, w1);
+    }
+
+    // True if any minute in [from, to) is booked (word-wise AND against the range mask)
+    public boolean anySet(int from, int to) {
+        if (from >= to) return false;
+        int w0 = from >>> 6, w1 = (to - 1) >>> 6;
+        long first = -1L << from;
+        long last = -1L >>> -to;
+        if (w0 == w1) return (words[w0] & first & last) != 0;
+        if ((words[w0] & first) != 0) return true;
+        for (int w = w0 + 1; w < w1; w++) if (words[w] != 0) return true;
+        return (words[w1] & last) != 0;
+    }
+
+    // First booked minute in [from, limit), or limit if none
+    public int nextSet(int from, int limit) {
+        if (from >= limit) return limit;
+        int w = from >>> 6, lastWord = (limit - 1) >>> 6;
+        long word = words[w] & (-1L << from);                         // ignore bits below from
+        while (true) {
+            if (word != 0) return Math.min((w << 6) + Long.numberOfTrailingZeros(word), limit);
+            if (++w > lastWord) return limit;
+            word = words[w];
+        }
+    }
+
+    // First free minute in [from, limit), or limit if none
+    public int nextClear(int from, int limit) {
+        if (from >= limit) return limit;
+        int w = from >>> 6, lastWord = (limit - 1) >>> 6;
+        long word = ~words[w] & (-1L << from);                        // free bits at or above from
+        while (true) {
+            if (word != 0) return Math.min((w << 6) + Long.numberOfTrailingZeros(word), limit);
+            if (++w > lastWord) return limit;
+            word = ~words[w];
+        }
+    }
+
+    // First minute s >= from with [s, s+len) free and inside [from, to) (capped at Sunday 23:59), or -1
+    public int firstFree(int from, int to, int len) {
+        return runs.firstFit(words, from, to, len);
+    }
+
+    // Copy of the raw words (snapshots)
+    public long[] copyWords() {
+        return words.clone();
+    }
+
+    // Replace every word with the next WORDS longs of src (snapshot load), then rebuild the tree
+    public void load(LongBuffer src) {
+        src.get(words);
+        runs.refresh(words, 0, WORDS - 1);
+    }
+}
@@ -12,6 +12,10 @@
  * - Strings are encoded as: uint16 length (BE) + UTF-8 bytes.
  * - Timestamps use 64-bit epochMillis (Java long) encoded big-endian.
  * - No Java serialization is used. Manual marshalling/unmarshalling is implemented in WireCodec.
+ * - OP_BATCH payload: uint16 count + [uint16 opCode + uint32 len + sub-payload]*.
+ *   Reply payload:   uint16 count + [uint16 status + uint32 len + sub-result]*, where status is
+ *   the sub-request's reply opCode (op, or op | OP_ERROR_MASK with an error payload). An item
+ *   the reply had no room for is not run and gets ERR_BATCH_FULL, as does every item after it.
  */
 
 import java.nio.ByteOrder;
@@ -21,10 +25,15 @@ public final class Protocol {
     public static final int VERSION = 1; // uint16 on wire
 
     // Op codes (uint16)
-    public static final int OP_QUERY_AVAIL          = 0x0001;
+    public static final int OP_QUERY_AVAIL          = 0x0001; // free runs of one day; overnight bookings block both days
     public static final int OP_BOOK                 = 0x0002;
     public static final int OP_CHANGE_BOOKING       = 0x0003;
     public static final int OP_MONITOR              = 0x0004;
+    public static final int OP_BATCH                = 0x0005; // many sub-requests in one datagram
+    public static final int OP_QUERY_WEEK           = 0x0006; // free intervals over a week-minute range
+    public static final int OP_FIND_FREE            = 0x0007; // first free runs of a minimum length
+    public static final int OP_FIND_ROOMS           = 0x0008; // facilities free over a whole range
+    public static final int OP_STATS                = 0x0009; // per-opcode latency percentiles + counters
     public static final int OP_CUSTOM_IDEMPOTENT    = 0x1001; // e.g., set display color
     public static final int OP_CUSTOM_NON_IDEMPOTENT= 0x1002; // e.g., increment counter / append audit
 
@@ -36,6 +45,7 @@ public final class Protocol {
     public static final int ERR_NOT_FOUND           = 2;  // booking not found
     public static final int ERR_BAD_REQUEST         = 3;  // malformed payload
     public static final int ERR_INTERNAL            = 4;  // server error
+    public static final int ERR_BATCH_FULL          = 5;  // batch item not run (reply full): resubmit it
 
     // Flags (uint32)
     public static final int FLAG_AT_MOST_ONCE = 1 << 0; // client requests at-most-once semantics
@@ -44,6 +54,9 @@ public final class Protocol {
     // Header length in bytes
     public static final int HEADER_LEN = 16;
 
+    // Largest UDP payload over IPv4 (65535 - 8 byte UDP header - 20 byte IP header)
+    public static final int MAX_DATAGRAM = 65507;
+
     // Network byte order for all integers
     public static final ByteOrder BYTE_ORDER = ByteOrder.BIG_ENDIAN;
 
@@ -5,11 +5,14 @@
  * - These are simple in-memory structures; no Java serialization is used.
  * - The wire format for these objects is defined and encoded/decoded in WireCodec.
  * - Updated to use weekly schedule format instead of timestamps.
+ * - Bookings and intervals hold plain int week minutes (minutes since Monday 00:00); WeeklyTime
+ *   is the day/hour/minute view used for display and by clients.
  */
 
-import java.util.List;
-import java.util.ArrayList;
 import java.util.Objects;
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.concurrent.atomic.AtomicReferenceArray;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
 
 public final class Types {
     /*
@@ -25,10 +28,10 @@ public final class Types {
             this.value = value;
         }
         
+        private static final Day[] BY_VALUE = values();   // value order; values() clones on every call
+
         public static Day fromValue(int value) {
-            for (Day day : values()) {
-                if (day.value == value) return day;
-            }
+            if (value >= 0 && value < BY_VALUE.length) return BY_VALUE[value];
             throw new IllegalArgumentException("Invalid day value: " + value);
         }
     }
@@ -85,44 +88,73 @@ public final class Types {
      * Interval - represents a time interval within a week
      */
     public static final class Interval {
-        public final WeeklyTime start; // start time within week
-        public final WeeklyTime end;   // end time within week
+        public final int start;        // start week minute
+        public final int end;          // end week minute (exclusive)
 
-        public Interval(WeeklyTime start, WeeklyTime end) {
+        public Interval(int start, int end) {
             this.start = start;
             this.end = end;
         }
 
         @Override
         public String toString() {
-            return "Interval{" + start + " - " + end + "}";
+            return "Interval{" + WeeklyTime.fromWeekMinutes(start) + " - " + WeeklyTime.fromWeekMinutes(end) + "}";
         }
         
         @Override
         public boolean equals(Object obj) {
             if (!(obj instanceof Interval)) return false;
             Interval other = (Interval) obj;
-            return start.equals(other.start) && end.equals(other.end);
+            return start == other.start && end == other.end;
         }
         
         @Override
         public int hashCode() {
-            return Objects.hash(start, end);
+            return 31 * start + end;
         }
     }
 
     /*
      * Facility
      * Holds a facility name and in-memory booking calendar.
-     * For simplicity we store existing bookings as a list; production systems would use an index/tree.
+     * Bookings are kept in a BookingIndex sorted by start minute for ordered range lookups, and
+     * mirrored in an OccupancyBitmap (one bit per week minute) for constant-time conflict checks.
+     * Each facility carries its own read/write lock so operations on different facilities never contend.
+     * dayVersions is bumped by every write touching a day; availCache holds encoded QUERY_AVAIL
+     * payloads tagged with the version they were built from, so a stale entry is simply a miss.
+     * ordinal is the facility's dense index in the server's cross-facility columns (-1 if not indexed).
      */
     public static final class Facility {
         public final String name;              // unique facility name
-        public final List<Booking> bookings;   // existing bookings for this facility
+        public final int ordinal;              // dense index for cross-facility search, or -1
+        public final BookingIndex bookings;    // existing bookings sorted by start; guarded by lock
+        public final OccupancyBitmap occupancy = new OccupancyBitmap(); // booked minutes; guarded by lock
+        public final ReentrantReadWriteLock lock = new ReentrantReadWriteLock(); // per-facility lock stripe
+        public final AtomicLongArray dayVersions = new AtomicLongArray(7);      // per-day write version
+        public final AtomicReferenceArray<CachedPayload> availCache = new AtomicReferenceArray<>(7); // per-day payload
 
         public Facility(String name) {
+            this(name, -1);                        // standalone: not indexed
+        }
+
+        public Facility(String name, int ordinal) {
             this.name = name;                      // set name
-            this.bookings = new ArrayList<>();     // initialize empty bookings list
+            this.ordinal = ordinal;                // set ordinal
+            this.bookings = new BookingIndex();    // initialize empty booking index
+        }
+    }
+
+    /*
+     * CachedPayload
+     * Immutable encoded response payload tagged with the data version it was computed from.
+     */
+    public static final class CachedPayload {
+        public final long version;      // Facility.dayVersions value at compute time
+        public final byte[] payload;    // encoded bytes (never mutated after publication)
+
+        public CachedPayload(long version, byte[] payload) {
+            this.version = version;     // version tag
+            this.payload = payload;     // encoded bytes
         }
     }
 
@@ -134,10 +166,10 @@ public final class Types {
         public final long id;           // booking id (uint64 on the wire)
         public final String facility;   // facility name this booking is for
         public final String user;       // user who made the booking
-        public WeeklyTime start;        // start time within week; mutable for change
-        public WeeklyTime end;          // end time within week; mutable for change
+        public int start;               // start week minute; mutable for change
+        public int end;                 // end week minute (exclusive); mutable for change
 
-        public Booking(long id, String facility, String user, WeeklyTime start, WeeklyTime end) {
+        public Booking(long id, String facility, String user, int start, int end) {
             this.id = id;               // assign booking id
             this.facility = facility;   // facility this booking belongs to
             this.user = user;           // booking user
@@ -147,7 +179,8 @@ public final class Types {
 
         @Override
         public String toString() {
-            return "Booking{" + id + "," + facility + "," + user + "," + start + "," + end + "}";
+            return "Booking{" + id + "," + facility + "," + user + "," + WeeklyTime.fromWeekMinutes(start) + ","
+                    + WeeklyTime.fromWeekMinutes(end) + "}";
         }
     }
 
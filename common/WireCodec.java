@@ -6,12 +6,20 @@
  * - Header is fixed 16 bytes; helper methods write/read header and primitives.
  * - Strings are length-prefixed with uint16 length and UTF-8 bytes.
  * - Timestamps are 64-bit epochMillis (Java long) encoded big-endian.
+ * - Replies are written into reusable direct buffers from a small per-thread pool
+ *   (acquireMessageBuffer/releaseMessageBuffer): beginMessage writes the header in place and
+ *   endMessage patches its payload length once the payload is known, so no Header object,
+ *   heap buffer or byte[] is needed per reply.
  */
 
 import java.nio.*;
 import java.nio.charset.StandardCharsets;
+import java.util.ArrayDeque;
 
 public final class WireCodec {
+    private static final int POOL_SIZE = 4;                        // buffers kept per thread
+    private static final ThreadLocal<ArrayDeque<ByteBuffer>> POOL =
+            ThreadLocal.withInitial(() -> new ArrayDeque<>(POOL_SIZE)); // idle reply buffers
 
     /*
      * Header structure used when building or parsing a UDP message.
@@ -43,6 +51,41 @@ public final class WireCodec {
         buf.putInt(h.payloadLen);                                  // payload length uint32
     }
 
+    // Write header fields directly (no Header object); payloadLen may be patched by endMessage
+    public static void writeHeader(ByteBuffer buf, int opCode, long requestId, long flags, int payloadLen) {
+        buf.putShort((short) Protocol.VERSION);                    // version uint16
+        buf.putShort((short) (opCode & 0xFFFF));                   // opCode uint16
+        buf.putInt((int) (requestId & 0xFFFFFFFFL));               // requestId uint32
+        buf.putInt((int) (flags & 0xFFFFFFFFL));                   // flags uint32
+        buf.putInt(payloadLen);                                    // payload length uint32
+    }
+
+    // Start a message of unknown payload length at buf's position; returns where it starts
+    public static int beginMessage(ByteBuffer buf, int opCode, long requestId, long flags) {
+        int start = buf.position();                                // header offset
+        writeHeader(buf, opCode, requestId, flags, 0);             // length patched by endMessage
+        return start;
+    }
+
+    // Finish a message begun at start: patch its payload length to what has been written since
+    public static void endMessage(ByteBuffer buf, int start) {
+        buf.putInt(start + 12, buf.position() - start - Protocol.HEADER_LEN); // absolute put
+    }
+
+    // Take a cleared direct buffer big enough for any datagram from this thread's pool
+    public static ByteBuffer acquireMessageBuffer() {
+        ByteBuffer buf = POOL.get().pollFirst();                   // reuse if one is idle
+        if (buf == null) return ByteBuffer.allocateDirect(Protocol.MAX_DATAGRAM).order(Protocol.BYTE_ORDER);
+        buf.clear();                                               // ready for writing
+        return buf;
+    }
+
+    // Return a buffer taken with acquireMessageBuffer on the same thread; the caller must not keep it
+    public static void releaseMessageBuffer(ByteBuffer buf) {
+        ArrayDeque<ByteBuffer> pool = POOL.get();
+        if (pool.size() < POOL_SIZE) pool.addFirst(buf);           // surplus buffers are left to GC
+    }
+
     // Read header from buffer starting at current position
     public static Header readHeader(ByteBuffer buf) {
         Header h = new Header();                                   // allocate header
@@ -90,19 +133,23 @@ public final class WireCodec {
         return new String(bytes, StandardCharsets.UTF_8);          // decode to String
     }
 
-    // Write WeeklyTime as: uint8 day + uint8 hour + uint8 minute (3 bytes total)
-    public static void writeWeeklyTime(ByteBuffer buf, Types.WeeklyTime time) {
-        buf.put((byte) time.day.value);                            // day as uint8 (0-6)
-        buf.put((byte) time.hour);                                 // hour as uint8 (0-23)
-        buf.put((byte) time.minute);                               // minute as uint8 (0-59)
+    // Write a week minute as WeeklyTime: uint8 day + uint8 hour + uint8 minute (3 bytes total)
+    public static void writeWeekMinutes(ByteBuffer buf, int weekMinutes) {
+        int dayMinutes = weekMinutes % (24 * 60);                  // minutes into the day
+        buf.put((byte) (weekMinutes / (24 * 60)));                 // day as uint8 (0-6)
+        buf.put((byte) (dayMinutes / 60));                         // hour as uint8 (0-23)
+        buf.put((byte) (dayMinutes % 60));                         // minute as uint8 (0-59)
     }
 
-    // Read WeeklyTime from: uint8 day + uint8 hour + uint8 minute (3 bytes total)
-    public static Types.WeeklyTime readWeeklyTime(ByteBuffer buf) {
-        int dayValue = Byte.toUnsignedInt(buf.get());              // read day (0-6)
+    // Read a WeeklyTime (uint8 day + uint8 hour + uint8 minute) as minutes since Monday 00:00
+    public static int readWeekMinutes(ByteBuffer buf) {
+        int day = Byte.toUnsignedInt(buf.get());                   // read day (0-6)
         int hour = Byte.toUnsignedInt(buf.get());                  // read hour (0-23)
         int minute = Byte.toUnsignedInt(buf.get());                // read minute (0-59)
-        return new Types.WeeklyTime(Types.Day.fromValue(dayValue), hour, minute);
+        if (day > 6 || hour > 23 || minute > 59) {                 // same bounds as WeeklyTime
+            throw new IllegalArgumentException("Invalid weekly time: " + day + " " + hour + ":" + minute);
+        }
+        return (day * 24 + hour) * 60 + minute;                    // no object per field
     }
 
     // Compute total message buffer: header + payload size
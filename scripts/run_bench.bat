@@ -0,0 +1,38 @@
+@echo off
+rem Compile server and benchmark sources, then run one benchmark class
+rem Usage: scripts\run_bench.bat <BenchClass> [args]
+setlocal
+
+rem Get the script directory and navigate to project root
+set SCRIPT_DIR=%~dp0
+set PROJECT_ROOT=%SCRIPT_DIR%..
+pushd "%PROJECT_ROOT%"
+
+if "%~1"=="" (
+    echo Usage: scripts\run_bench.bat ^<BenchClass^> [args]
+    echo Available benchmarks:
+    for %%f in (bench\*.java) do echo   %%~nf
+    popd
+    exit /b 1
+)
+
+rem Compile all Java sources to bin
+if not exist bin mkdir bin
+javac -d bin common\*.java server\*.java bench\*.java
+if errorlevel 1 goto :done
+
+rem Run the requested benchmark with remaining args
+set BENCH=%1
+shift
+set ARGS=
+:collect
+if "%~1"=="" goto :run
+set ARGS=%ARGS% %1
+shift
+goto :collect
+:run
+java -cp bin %BENCH% %ARGS%
+
+:done
+popd
+endlocal
@@ -0,0 +1,211 @@
+/*
+ * AtMostOnceCache.java
+ * Purpose: Remembers replies to at-most-once requests so retransmitted requests are answered
+ *          from the cache instead of being executed again.
+ * Design notes:
+ * - Keyed by (client address, client port, requestId), so ids picked independently by
+ *   different clients do not collide.
+ * - Time-bucketed ring: the TTL is split into BUCKETS ticks and each entry is appended to the
+ *   key queue of the tick it was stored in. Expiring a tick drains one queue, so cost follows
+ *   the number of expired entries rather than the size of the cache.
+ * - Expiry runs on its own daemon thread (start()), independent of request traffic. Lookups
+ *   also check the entry's tick, so a late expiry thread never serves a stale reply. Each pass is
+ *   a ServerEvents.CacheSweep flight-recorder event.
+ * - Bounded: when maxEntries is reached the oldest live tick is evicted early and counted. The
+ *   eviction cursor never passes the current tick; if only current-tick entries remain, they
+ *   are evicted one at a time in storage order.
+ * - Each reply keeps the write-ahead log LSN of the request that produced it, so a retransmit
+ *   answered from the cache still waits until the original mutation is durable.
+ * - Workers may share one socket (no SO_REUSEPORT), so a retransmit can reach a second worker
+ *   while the first still runs the request. reserve() therefore claims the key atomically with
+ *   an in-flight marker before the request runs; a duplicate that finds the marker is dropped
+ *   (the client retransmits again and gets the cached reply), and put() replaces the marker.
+ */
+
+import java.net.InetAddress;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.LongAdder;
+
+public class AtMostOnceCache {
+    private static final int BUCKETS = 16;       // ticks per TTL
+
+    // Cache key: one request from one client endpoint
+    private static final class Key {
+        final InetAddress addr;  // client IP address
+        final int port;          // client UDP port
+        final long requestId;    // client-chosen request id
+        Key(InetAddress addr, int port, long requestId) { this.addr = addr; this.port = port; this.requestId = requestId; }
+        @Override public boolean equals(Object o) {
+            if (!(o instanceof Key)) return false;
+            Key k = (Key) o;
+            return requestId == k.requestId && port == k.port && addr.equals(k.addr);
+        }
+        @Override public int hashCode() { return (Long.hashCode(requestId) * 31 + port) * 31 + addr.hashCode(); }
+    }
+
+    // Cached reply, the LSN it depends on and the tick it was stored in
+    static final class Entry {
+        final byte[] response;   // full datagram response bytes (null: request still running)
+        final long lsn;          // WAL LSN the reply waits for (0 = none)
+        final long tick;         // storage tick
+        Entry(byte[] response, long lsn, long tick) { this.response = response; this.lsn = lsn; this.tick = tick; }
+        boolean inFlight() { return response == null; }
+    }
+
+    private final long tickMs;                                                  // width of one bucket
+    private final long baseMs = System.currentTimeMillis();                     // tick 0
+    private final int maxEntries;                                               // occupancy bound
+    private final ConcurrentHashMap<Key, Entry> entries = new ConcurrentHashMap<>(); // key -> reply
+    private final ConcurrentLinkedQueue<Key>[] ring;                            // keys stored per tick
+    private long oldestTick;                                                    // next tick to drain (guarded by this)
+
+    private final LongAdder lookups = new LongAdder();     // at-most-once lookups
+    private final LongAdder hits = new LongAdder();        // lookups answered from the cache
+    private final LongAdder inFlightDrops = new LongAdder(); // duplicates dropped while the original ran
+    private final LongAdder expirations = new LongAdder(); // entries dropped after their TTL
+    private final LongAdder evictions = new LongAdder();   // entries dropped early to stay under maxEntries
+
+    @SuppressWarnings("unchecked")
+    public AtMostOnceCache(long ttlMs, int maxEntries) {
+        this.tickMs = Math.max(1, ttlMs / BUCKETS);                             // TTL split into ticks
+        this.maxEntries = Math.max(1, maxEntries);
+        this.ring = new ConcurrentLinkedQueue[BUCKETS];
+        for (int i = 0; i < BUCKETS; i++) ring[i] = new ConcurrentLinkedQueue<>();
+    }
+
+    // Start the expiry thread (daemon, wakes once per tick)
+    public void start() {
+        Thread t = new Thread(() -> {
+            while (true) {
+                try {
+                    Thread.sleep(tickMs);
+                } catch (InterruptedException ie) {
+                    return;                                                     // shutdown
+                }
+                expire();
+            }
+        }, "amo-cache-expiry");
+        t.setDaemon(true);
+        t.start();
+    }
+
+    // Claim this request before running it. Returns null if the caller now owns it (an in-flight
+    // marker holds the key until put() or abandon()); otherwise the cached reply, or an in-flight
+    // entry if another worker is running the same request right now.
+    Entry reserve(InetAddress addr, int port, long requestId) {
+        lookups.increment();
+        if (entries.size() >= maxEntries) evictOldest();                        // keep occupancy bounded
+        long tick = currentTick();
+        Key k = new Key(addr, port, requestId);
+        Entry marker = new Entry(null, 0, tick);
+        while (true) {
+            Entry e = entries.putIfAbsent(k, marker);                           // atomic claim
+            if (e == null || (e.tick <= tick - BUCKETS && entries.replace(k, e, marker))) {
+                ring[(int) (tick % BUCKETS)].add(k);                            // expires even if abandoned
+                return null;
+            }
+            if (e.tick <= tick - BUCKETS) continue;                             // stale entry changed under us
+            if (e.inFlight()) inFlightDrops.increment();
+            else hits.increment();
+            return e;
+        }
+    }
+
+    // Remember the reply for this request, replacing its in-flight marker
+    public void put(InetAddress addr, int port, long requestId, byte[] response, long lsn) {
+        long tick = currentTick();
+        Key k = new Key(addr, port, requestId);
+        Entry prev = entries.put(k, new Entry(response, lsn, tick));
+        if (prev == null && entries.size() > maxEntries) evictOldest();        // not reserved first
+        if (prev == null || prev.tick != tick) ring[(int) (tick % BUCKETS)].add(k); // expire with this tick
+    }
+
+    // Release a reservation whose request produced no reply
+    public void abandon(InetAddress addr, int port, long requestId) {
+        entries.computeIfPresent(new Key(addr, port, requestId), (k, e) -> e.inFlight() ? null : e);
+    }
+
+    // Drop every tick that has fallen out of the TTL window
+    public synchronized void expire() {
+        ServerEvents.CacheSweep event = new ServerEvents.CacheSweep();
+        event.begin();
+        long last = currentTick() - BUCKETS;                                    // newest expired tick
+        int removed = 0;
+        while (oldestTick <= last) {
+            int n = drain(oldestTick);
+            expirations.add(n);
+            removed += n;
+            oldestTick++;
+        }
+        if (event.shouldCommit()) {
+            event.cache = "amoCache"; event.removed = removed; event.remaining = entries.size();
+            event.commit();
+        }
+    }
+
+    // Drop the oldest tick still holding entries, ahead of its TTL. The cursor stops before the
+    // current tick, so it never runs ahead of real time; once only current-tick entries are left
+    // the oldest of those goes instead.
+    private synchronized void evictOldest() {
+        long now = currentTick();
+        while (oldestTick < now) {
+            int n = drain(oldestTick++);
+            evictions.add(n);
+            if (n > 0) return;                                                  // freed some room
+        }
+        evictFirst(now);
+    }
+
+    // Evict the first-stored finished reply of the current tick (in-flight markers stay queued)
+    private void evictFirst(long now) {
+        ConcurrentLinkedQueue<Key> q = ring[(int) (now % BUCKETS)];
+        for (int i = q.size(); i > 0; i--) {                                    // FIFO: oldest key first
+            Key k = q.poll();
+            if (k == null) return;
+            Entry e = entries.get(k);
+            if (e == null) continue;                                            // already gone
+            if (e.tick < now) {                                                 // left from an earlier lap: expired
+                if (entries.remove(k, e)) expirations.increment();
+                continue;
+            }
+            if (e.inFlight()) { q.add(k); continue; }                           // still claimed by a worker
+            if (entries.remove(k, e)) { evictions.increment(); return; }
+        }
+    }
+
+    // Remove entries stored at or before tick from its ring slot; returns the count removed
+    private int drain(long tick) {
+        ConcurrentLinkedQueue<Key> q = ring[(int) (tick % BUCKETS)];
+        int removed = 0;
+        for (int i = q.size(); i > 0; i--) {                                    // only keys queued so far
+            Key k = q.poll();
+            if (k == null) break;
+            Entry e = entries.get(k);
+            if (e == null) continue;                                            // already replaced and drained
+            if (e.tick <= tick) {
+                if (entries.remove(k, e)) removed++;
+            } else if (e.tick % BUCKETS == tick % BUCKETS) {
+                q.add(k);                                                       // stored after the ring wrapped
+            }
+        }
+        return removed;
+    }
+
+    private long currentTick() {
+        return (System.currentTimeMillis() - baseMs) / tickMs;
+    }
+
+    // Metrics
+    public int size() { return entries.size(); }
+    public int maxEntries() { return maxEntries; }
+    public long lookups() { return lookups.sum(); }
+    public long hits() { return hits.sum(); }
+    public long inFlightDrops() { return inFlightDrops.sum(); }
+    public long expirations() { return expirations.sum(); }
+    public long evictions() { return evictions.sum(); }
+    public double hitRate() {
+        long n = lookups.sum();
+        return n == 0 ? 0.0 : hits.sum() / (double) n;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * AvailabilityCache.java
+ * Purpose: Serves encoded QUERY_AVAIL payloads (u16 count + [WeeklyTime start, WeeklyTime end]*)
+ *          per (facility, day), recomputing only after a write touched that day.
+ * Design notes:
+ * - Entries live in Types.Facility.availCache, tagged with the Facility.dayVersions value read
+ *   before computing. Writers bump the version under the facility write lock after mutating,
+ *   so a tag that still equals the current version guarantees the bytes are up to date.
+ * - Hits take no lock: one volatile array read, one version compare.
+ * - A racing miss may publish an already-stale entry; it fails the version check and is rebuilt.
+ */
+
+import java.nio.ByteBuffer;
+import java.util.List;
+import java.util.concurrent.atomic.LongAdder;
+
+public class AvailabilityCache {
+    private final ReservationLogic logic;            // facility lookup; computes intervals on a miss
+    private final LongAdder hits = new LongAdder();  // served from cache
+    private final LongAdder misses = new LongAdder(); // recomputed
+
+    public AvailabilityCache(ReservationLogic logic) {
+        this.logic = logic;                          // assign dependency
+    }
+
+    // Encoded availability payload for facility/day; callers must not modify the returned array
+    public byte[] payload(String facility, Types.Day day) {
+        Types.Facility f = logic.getFacility(facility);                    // lookup facility
+        if (f == null) {                                                   // unknown: nothing to cache
+            misses.increment();
+            return encode(logic.queryDay(facility, day));
+        }
+        long version = f.dayVersions.get(day.value);                       // current write version
+        Types.CachedPayload cached = f.availCache.get(day.value);          // cached entry, if any
+        if (cached != null && cached.version == version) {
+            hits.increment();
+            return cached.payload;                                         // up-to-date bytes
+        }
+        misses.increment();
+        byte[] payload = encode(logic.queryDay(facility, day));            // recompute
+        f.availCache.set(day.value, new Types.CachedPayload(version, payload)); // publish tagged entry
+        return payload;
+    }
+
+    public long hits() { return hits.sum(); }
+    public long misses() { return misses.sum(); }
+
+    // Encode intervals as u16 count + [WeeklyTime start, WeeklyTime end]*
+    static byte[] encode(List<Types.Interval> ivals) {
+        ByteBuffer out = WireCodec.allocate(2 + ivals.size() * 6);         // exact payload size
+        WireCodec.writeU16(out, ivals.size());                             // write count
+        for (Types.Interval iv : ivals) {
+            WireCodec.writeWeekMinutes(out, iv.start);                     // write start time
+            WireCodec.writeWeekMinutes(out, iv.end);                       // write end time
+        }
+        return out.array();
+    }
+
+    // Encode intervals the same way straight into a reply buffer at its position
+    static void encode(List<Types.Interval> ivals, ByteBuffer out) {
+        WireCodec.writeU16(out, ivals.size());                             // write count
+        for (Types.Interval iv : ivals) {
+            WireCodec.writeWeekMinutes(out, iv.start);                     // write start time
+            WireCodec.writeWeekMinutes(out, iv.end);                       // write end time
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * CallbackFanout.java
+ * Purpose: Sends monitor callbacks on dedicated sender threads so receive workers never block
+ *          on fan-out to hundreds of monitors.
+ * Design notes:
+ * - Workers submit (facility, day) keys into a bounded queue and return immediately.
+ * - Coalescing: a key already waiting in the queue is not queued again. The sender builds the
+ *   payload from current state when it dequeues the key, so all pending updates collapse into
+ *   the newest availability. The key leaves the pending set before the payload is built, so a
+ *   write racing with the send re-queues the key rather than being lost.
+ * - When the queue is full the new key is dropped and counted; monitors get the next change.
+ * - Each handled key is a ServerEvents.CallbackBatch flight-recorder event (datagrams sent and
+ *   the time the key waited in the queue).
+ * - Metrics: queue depth, submitted/coalesced/dropped keys, datagrams sent, and fan-out latency
+ *   (submit to last datagram sent) as total and max in nanoseconds.
+ */
+
+import java.net.*;
+import java.util.Collection;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.BlockingQueue;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ThreadLocalRandom;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.LongAdder;
+
+public class CallbackFanout {
+    // Queue key: one facility day
+    private static final class Key {
+        final String facility;   // facility name
+        final int day;           // day value (0-6)
+        Key(String facility, int day) { this.facility = facility; this.day = day; }
+        @Override public boolean equals(Object o) {
+            if (!(o instanceof Key)) return false;
+            Key k = (Key) o;
+            return day == k.day && facility.equals(k.facility);
+        }
+        @Override public int hashCode() { return facility.hashCode() * 7 + day; }
+    }
+
+    private final RequestRouter router;                       // builds callback datagrams
+    private final MonitorRegistry monitors;                   // callback targets
+    private final DatagramSocket sock;                        // send socket (thread-safe send)
+    private final double lossSim;                             // probability to drop callbacks
+    private final BlockingQueue<Key> queue;                   // bounded work queue
+    private final ConcurrentHashMap<Key, Long> pending = new ConcurrentHashMap<>(); // queued key -> submit nanoTime
+
+    private final LongAdder submitted = new LongAdder();      // keys accepted into the queue
+    private final LongAdder coalesced = new LongAdder();      // keys merged into a queued one
+    private final LongAdder dropped = new LongAdder();        // keys rejected because the queue was full
+    private final LongAdder datagrams = new LongAdder();      // callback datagrams sent
+    private final LongAdder latencyTotalNs = new LongAdder(); // sum of submit->sent latency
+    private final LongAdder latencyCount = new LongAdder();   // keys fanned out
+    private final AtomicLong latencyMaxNs = new AtomicLong(); // worst submit->sent latency
+
+    public CallbackFanout(RequestRouter router, MonitorRegistry monitors, DatagramSocket sock,
+                          double lossSim, int capacity) {
+        this.router = router; this.monitors = monitors; this.sock = sock; this.lossSim = lossSim; // assign dependencies
+        this.queue = new ArrayBlockingQueue<>(capacity);                                          // bounded queue
+    }
+
+    // Start sender threads (daemon, so they never keep the JVM alive)
+    public void start(int threads) {
+        for (int i = 0; i < threads; i++) {
+            Thread t = new Thread(this::senderLoop, "callback-sender-" + i);
+            t.setDaemon(true);
+            t.start();
+        }
+    }
+
+    // Queue a callback for facility/day; never blocks the caller
+    public void submit(String facility, Types.Day day) {
+        Key k = new Key(facility, day.value);
+        if (pending.putIfAbsent(k, System.nanoTime()) != null) {    // already queued: newest state wins
+            coalesced.increment();
+            return;
+        }
+        if (queue.offer(k)) {
+            submitted.increment();
+        } else {                                                    // full: shed load, keep workers fast
+            pending.remove(k);
+            dropped.increment();
+        }
+    }
+
+    private void senderLoop() {
+        while (true) {
+            Key k;
+            try {
+                k = queue.take();                                   // wait for work
+            } catch (InterruptedException ie) {
+                return;                                             // shutdown
+            }
+            Long submittedAt = pending.remove(k);                   // later writes will re-queue
+            ServerEvents.CallbackBatch event = new ServerEvents.CallbackBatch();
+            long dequeuedAt = System.nanoTime();
+            event.begin();
+            int sent = 0;
+            try {
+                sent = fanOut(k);
+            } catch (Exception ignore) { /* ignore callback errors; monitors get the next change */ }
+            if (event.shouldCommit()) {
+                event.facility = k.facility; event.day = k.day; event.datagrams = sent;
+                event.queueDelay = submittedAt == null ? 0 : dequeuedAt - submittedAt;
+                event.commit();
+            }
+            if (submittedAt != null) recordLatency(System.nanoTime() - submittedAt);
+        }
+    }
+
+    // Send the newest availability to every live monitor of k; returns the datagrams sent
+    private int fanOut(Key k) throws java.io.IOException {
+        Collection<MonitorRegistry.Entry> targets = monitors.getActiveFor(k.facility); // live view, no copy
+        if (targets.isEmpty()) return 0;                            // nobody listening
+        byte[] cb = null;                                           // built on first active target
+        long now = System.currentTimeMillis();                      // lease check time
+        ThreadLocalRandom rnd = ThreadLocalRandom.current();        // RNG for loss sim
+        int sent = 0;                                               // datagrams sent
+        for (MonitorRegistry.Entry m : targets) {
+            if (!m.isActive(now)) continue;                         // lease ran out, not swept yet
+            if (cb == null) cb = router.buildCallback(k.facility, Types.Day.fromValue(k.day)); // newest availability
+            if (rnd.nextDouble() < lossSim) continue;               // drop callback
+            sock.send(new DatagramPacket(cb, cb.length, m.addr, m.port));
+            datagrams.increment();
+            sent++;
+        }
+        return sent;
+    }
+
+    private void recordLatency(long ns) {
+        latencyTotalNs.add(ns);
+        latencyCount.increment();
+        latencyMaxNs.accumulateAndGet(ns, Math::max);
+    }
+
+    // Metrics
+    public int queueDepth() { return queue.size(); }
+    public long submitted() { return submitted.sum(); }
+    public long coalesced() { return coalesced.sum(); }
+    public long dropped() { return dropped.sum(); }
+    public long datagramsSent() { return datagrams.sum(); }
+    public long maxLatencyNs() { return latencyMaxNs.get(); }
+    public long avgLatencyNs() {
+        long n = latencyCount.sum();
+        return n == 0 ? 0 : latencyTotalNs.sum() / n;
+    }
+}
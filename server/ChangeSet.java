@@ -0,0 +1,70 @@
+/*
+ * ChangeSet.java
+ * Purpose: Collects the (facility, day) pairs a request actually modified, so monitor callbacks
+ *          are rebuilt only for those days.
+ * Design notes:
+ * - Filled by ReservationLogic/FacilityStore after a mutation succeeds; read by the worker once
+ *   the response has been sent.
+ * - Days are kept as a 7-bit mask per facility; one instance per worker is cleared and reused.
+ * - Also carries the highest write-ahead log LSN the request produced (0 = nothing logged);
+ *   the worker holds the reply until that LSN is durable.
+ */
+
+import java.util.Arrays;
+
+public final class ChangeSet {
+    private static final int DAY_MINUTES = 24 * 60;      // minutes per day
+
+    private String[] facilities = new String[2];         // distinct facilities touched
+    private int[] dayMasks = new int[2];                 // bit d set => day d changed
+    private int size;                                    // number of facilities recorded
+    private long lsn;                                    // highest LSN logged by the request
+
+    // Forget everything recorded for the previous request
+    public void clear() {
+        Arrays.fill(facilities, 0, size, null);
+        size = 0;
+        lsn = 0;
+    }
+
+    // Record a log sequence number the reply must wait for
+    public void setLsn(long lsn) {
+        this.lsn = Math.max(this.lsn, lsn);
+    }
+
+    // Independent copy, for work deferred past the next request
+    public ChangeSet copy() {
+        ChangeSet c = new ChangeSet();
+        c.facilities = Arrays.copyOf(facilities, Math.max(size, 1));
+        c.dayMasks = Arrays.copyOf(dayMasks, Math.max(size, 1));
+        c.size = size;
+        c.lsn = lsn;
+        return c;
+    }
+
+    // Record every day overlapped by [startMinutes, endMinutes)
+    public void addRange(String facility, int startMinutes, int endMinutes) {
+        if (endMinutes <= startMinutes) return;
+        int mask = 0;
+        for (int d = startMinutes / DAY_MINUTES; d <= (endMinutes - 1) / DAY_MINUTES; d++) mask |= 1 << d;
+        addMask(facility, mask);
+    }
+
+    private void addMask(String facility, int mask) {
+        for (int i = 0; i < size; i++) {
+            if (facilities[i].equals(facility)) { dayMasks[i] |= mask; return; } // merge into existing
+        }
+        if (size == facilities.length) {
+            facilities = Arrays.copyOf(facilities, size * 2);
+            dayMasks = Arrays.copyOf(dayMasks, size * 2);
+        }
+        facilities[size] = facility;
+        dayMasks[size] = mask;
+        size++;
+    }
+
+    public int size() { return size; }
+    public String facility(int i) { return facilities[i]; }
+    public int dayMask(int i) { return dayMasks[i]; }
+    public long lsn() { return lsn; }
+}
@@ -0,0 +1,105 @@
+/*
+ * FacilityColumns.java
+ * Purpose: Columnar index answering "which facilities are free over [from, to)?" without
+ *          visiting every facility: one busy bit per (5-minute bucket, facility ordinal).
+ * Design notes:
+ * - Facilities get dense ordinals when first created. Ordinals are grouped in blocks of 64; a
+ *   block holds one long per bucket (2,016 buckets), bit i set = facility 64*block+i has a booked
+ *   minute in that bucket. Bucket k's bitset over all facilities is word k of every block.
+ * - A range query ORs a block's words over the covered buckets (one sequential run of longs)
+ *   and complements it, deciding 64 facilities per word. Buckets only partly covered by the
+ *   range are settled per candidate against its occupancy bitmap under its read lock.
+ * - Writers refresh the buckets they touched from the facility's bitmap (FacilityStore.touchDays,
+ *   under the facility write lock). Facilities of one block share words, so bits change by CAS.
+ * - Blocks are appended and never moved, so growing never loses a concurrent update.
+ * - Queries take no index lock and see each word as of when it is read.
+ * - The OR runs as a plain scalar loop, not the JDK Vector API: the words must live in
+ *   AtomicLongArray for the CAS updates above, and vector loads only read long[] or memory
+ *   segments. The API is also still an incubator module, so every javac/java invocation in
+ *   scripts/ would need --add-modules jdk.incubator.vector.
+ */
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicLongArray;
+
+public class FacilityColumns {
+    public static final int BUCKET_MINUTES = 5;                                   // bucket width
+    private static final int BUCKETS = OccupancyBitmap.WEEK_MINUTES / BUCKET_MINUTES; // 2,016 per week
+
+    private volatile AtomicLongArray[] blocks = new AtomicLongArray[0];          // busy words per 64 ordinals
+    private volatile Types.Facility[] byOrdinal = new Types.Facility[64];         // facility per ordinal
+    private volatile int size;                                                    // ordinals handed out
+
+    // Create a facility with the next ordinal (called once per name from FacilityStore)
+    public synchronized Types.Facility register(String name) {
+        int ordinal = size;
+        Types.Facility f = new Types.Facility(name, ordinal);
+        Types.Facility[] facs = byOrdinal;
+        if (ordinal == facs.length) facs = Arrays.copyOf(facs, ordinal * 2);     // grow by copy
+        facs[ordinal] = f;
+        byOrdinal = facs;
+        if ((ordinal & 63) == 0) {                                                // first ordinal of a new block
+            AtomicLongArray[] grown = Arrays.copyOf(blocks, blocks.length + 1);
+            grown[grown.length - 1] = new AtomicLongArray(BUCKETS);               // all free
+            blocks = grown;
+        }
+        size = ordinal + 1;                                                       // publish last
+        return f;
+    }
+
+    // Recompute f's busy bits for the buckets overlapping [from, to); caller holds f's write lock
+    public void refresh(Types.Facility f, int from, int to) {
+        if (f.ordinal < 0 || to <= from) return;                                  // not indexed, or empty range
+        AtomicLongArray col = blocks[f.ordinal >>> 6];
+        long bit = 1L << f.ordinal;                                               // shift uses the low 6 bits
+        for (int k = from / BUCKET_MINUTES, last = (to - 1) / BUCKET_MINUTES; k <= last; k++) {
+            boolean busy = f.occupancy.anySet(k * BUCKET_MINUTES, (k + 1) * BUCKET_MINUTES);
+            while (true) {
+                long w = col.get(k);
+                if (((w & bit) != 0) == busy) break;                              // already right
+                if (col.compareAndSet(k, w, busy ? w | bit : w & ~bit)) break;    // lost a race: retry
+            }
+        }
+    }
+
+    // Names of facilities with no booked minute in [from, to), in creation order, at most max
+    public List<String> freeDuring(int from, int to, int max) {
+        List<String> out = new ArrayList<>();
+        if (to <= from) return out;
+        int n = size;                                                             // read before the arrays
+        Types.Facility[] facs = byOrdinal;
+        AtomicLongArray[] cols = blocks;
+        int k0 = from / BUCKET_MINUTES, k1 = (to - 1) / BUCKET_MINUTES;           // buckets touched
+        int i0 = from % BUCKET_MINUTES == 0 ? k0 : k0 + 1;                        // fully covered buckets
+        int i1 = to % BUCKET_MINUTES == 0 ? k1 : k1 - 1;
+        for (int b = 0; b << 6 < n && out.size() < max; b++) {
+            AtomicLongArray col = cols[b];
+            long valid = n - (b << 6) >= 64 ? -1L : (1L << (n - (b << 6))) - 1;  // ordinals in use
+            long busy = ~valid;
+            for (int k = i0; k <= i1 && busy != -1L; k++) busy |= col.get(k);     // stop once all are busy
+            long edge = 0;                                                        // busy somewhere in a partial bucket
+            if (i0 != k0) edge |= col.get(k0);
+            if (i1 != k1) edge |= col.get(k1);
+            for (long m = ~busy; m != 0 && out.size() < max; m &= m - 1) {
+                Types.Facility f = facs[(b << 6) + Long.numberOfTrailingZeros(m)];
+                if ((edge & m & -m) == 0 || isFree(f, from, to)) out.add(f.name); // exact check at the edges
+            }
+        }
+        return out;
+    }
+
+    // Exact test against the facility's bitmap
+    private static boolean isFree(Types.Facility f, int from, int to) {
+        f.lock.readLock().lock();
+        try {
+            return !f.occupancy.anySet(from, to);
+        } finally {
+            f.lock.readLock().unlock();
+        }
+    }
+
+    public int size() { return size; }
+    public Types.Facility facility(int ordinal) { return byOrdinal[ordinal]; }
+}
@@ -2,82 +2,188 @@
  * FacilityStore.java
  * Purpose: In-memory storage for facilities and bookings.
  * Design notes:
- * - Thread-safe via synchronized blocks; server can be single-threaded but we prepare for concurrency.
- * - Stores facilityName -> Facility and bookingId -> Booking maps.
+ * - Lock striping: the name and id maps are concurrent; each facility's booking index is guarded
+ *   by that facility's own read/write lock, so work on different facilities runs in parallel.
+ * - Compound check-then-act sequences (e.g. overlap check + add) hold the facility write lock
+ *   in ReservationLogic; the locks are reentrant so the methods below can be called inside.
+ * - Stores facilityName -> Facility and bookingId -> Booking maps, plus per-facility usage counters.
+ * - Every add/remove also updates the facility's occupancy bitmap so it mirrors the index,
+ *   and bumps the version of each day it touched (see touchDays) to invalidate cached payloads.
+ * - touchDays also refreshes the facility's bits in the cross-facility FacilityColumns index;
+ *   facilities are created through that index so each one gets a dense ordinal.
  */
 
+import java.nio.LongBuffer;
 import java.util.Map;
-import java.util.HashMap;
 import java.util.List;
-import java.util.ArrayList;
 import java.util.Collections;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicLong;
 
 public class FacilityStore {
-    private final Map<String, Types.Facility> facilities = new HashMap<>(); // name->facility map
-    private final Map<Long, Types.Booking> bookings = new HashMap<>();      // id->booking map
-    private long nextBookingId = 1L;                                        // simple id generator
+    private final Map<String, Types.Facility> facilities = new ConcurrentHashMap<>(); // name->facility map
+    private final Map<Long, Types.Booking> bookings = new ConcurrentHashMap<>();      // id->booking map
+    private final AtomicLong nextBookingId = new AtomicLong(1L);                      // simple id generator
+    private final FacilityColumns columns = new FacilityColumns();                    // cross-facility busy bits
+    private final Map<String, Long> usageCounters = new ConcurrentHashMap<>();        // facility -> usage counter
 
     // Ensure facility exists; create if absent
-    public synchronized Types.Facility ensureFacility(String name) {
-        return facilities.computeIfAbsent(name, Types.Facility::new); // create new facility if missing
+    public Types.Facility ensureFacility(String name) {
+        return facilities.computeIfAbsent(name, columns::register); // create (and index) if missing
+    }
+
+    // Cross-facility availability index
+    public FacilityColumns columns() {
+        return columns;
     }
 
     // Get facility or null
-    public synchronized Types.Facility getFacility(String name) {
+    public Types.Facility getFacility(String name) {
         return facilities.get(name); // return facility by name
     }
 
     // Generate a new booking id
-    public synchronized long newBookingId() {
-        return nextBookingId++; // increment and return; non-persistent
+    public long newBookingId() {
+        return nextBookingId.getAndIncrement(); // increment and return; non-persistent
+    }
+
+    // Next id newBookingId() would return (snapshots)
+    public long peekNextBookingId() {
+        return nextBookingId.get();
+    }
+
+    // Make sure newBookingId() returns at least next (log replay)
+    public void reserveBookingIds(long next) {
+        nextBookingId.accumulateAndGet(next, Math::max);
     }
 
     // Save booking into global and facility lists
-    public synchronized void addBooking(Types.Booking b) {
-        bookings.put(b.id, b);                         // put into id map
+    public void addBooking(Types.Booking b) {
         Types.Facility f = ensureFacility(b.facility); // ensure facility exists
-        f.bookings.add(b);                             // add booking to facility list
+        f.lock.writeLock().lock();                     // exclusive on this facility only
+        try {
+            f.bookings.add(b);                         // insert into facility index
+            f.occupancy.set(b.start, b.end);           // mark minutes booked
+            touchDays(f, b.start, b.end);              // invalidate cached days
+            bookings.put(b.id, b);                     // put into id map
+        } finally {
+            f.lock.writeLock().unlock();
+        }
+    }
+
+    // Install a facility's whole index and bitmap at once (snapshot load; the facility is empty).
+    // items/starts/ends are handed to the BookingIndex as is; words are its OccupancyBitmap words.
+    public void loadFacility(Types.Facility f, Types.Booking[] items, int[] starts, int[] ends, int n, LongBuffer words) {
+        f.lock.writeLock().lock();
+        try {
+            f.bookings.load(starts, ends, items, n);         // index arrays, no per-booking insert
+            f.occupancy.load(words);                         // bitmap words, tree rebuilt once
+            for (int i = 0; i < n; i++) bookings.put(items[i].id, items[i]); // id map
+            touchDays(f, 0, OccupancyBitmap.WEEK_MINUTES);   // columns and day versions, once
+        } finally {
+            f.lock.writeLock().unlock();
+        }
+    }
+
+    // Move a booking to [start, end); the caller has checked for conflicts
+    public void moveBooking(Types.Booking b, int start, int end) {
+        Types.Facility f = ensureFacility(b.facility);
+        f.lock.writeLock().lock();
+        try {
+            int oldStart = b.start, oldEnd = b.end;
+            f.bookings.remove(b);                      // unindex at the old position
+            f.occupancy.clear(oldStart, oldEnd);       // free the old minutes
+            b.start = start;                           // apply update
+            b.end = end;
+            f.bookings.add(b);                         // re-index at the new position
+            f.occupancy.set(start, end);               // mark the new minutes booked
+            touchDays(f, oldStart, oldEnd);            // old days changed
+            touchDays(f, start, end);                  // new days changed
+        } finally {
+            f.lock.writeLock().unlock();
+        }
+    }
+
+    // Increment a facility's usage counter; returns the new value
+    public long incrementUsage(String facility) {
+        return usageCounters.merge(facility, 1L, Long::sum);   // atomic increment (non-idempotent)
+    }
+
+    // Raise a usage counter to at least value (log replay; order-insensitive)
+    public void raiseUsage(String facility, long value) {
+        usageCounters.merge(facility, value, Math::max);
+    }
+
+    // Read-only view of the usage counters (snapshots)
+    public Map<String, Long> usageCounters() {
+        return Collections.unmodifiableMap(usageCounters);
     }
 
     // Lookup booking by id
-    public synchronized Types.Booking getBooking(long id) {
+    public Types.Booking getBooking(long id) {
         return bookings.get(id); // return booking or null
     }
 
     // Remove booking (if needed)
-    public synchronized void removeBooking(long id) {
-        Types.Booking b = bookings.remove(id);         // remove from id map
-        if (b != null) {
-            Types.Facility f = facilities.get(b.facility); // get facility
-            if (f != null) f.bookings.remove(b);       // remove from facility list
+    public void removeBooking(long id) {
+        Types.Booking b = bookings.get(id);            // find booking first to learn its facility
+        if (b == null) return;
+        Types.Facility f = facilities.get(b.facility); // get facility
+        if (f == null) return;
+        f.lock.writeLock().lock();
+        try {
+            if (bookings.remove(id, b) && f.bookings.remove(b)) {  // remove from id map and facility index
+                f.occupancy.clear(b.start, b.end);     // free its minutes
+                touchDays(f, b.start, b.end);          // invalidate cached days
+            }
+        } finally {
+            f.lock.writeLock().unlock();
         }
     }
 
     // Get snapshot list of bookings for facility
-    public synchronized List<Types.Booking> getFacilityBookings(String name) {
+    public List<Types.Booking> getFacilityBookings(String name) {
         Types.Facility f = facilities.get(name);             // lookup facility
         if (f == null) return Collections.emptyList();       // no facility
-        return new ArrayList<>(f.bookings);                  // copy to avoid external mutation
+        f.lock.readLock().lock();
+        try {
+            return f.bookings.toList();                      // copy to avoid external mutation
+        } finally {
+            f.lock.readLock().unlock();
+        }
+    }
+
+    // Bump the version of every day overlapped by [startMinutes, endMinutes) and refresh the range in
+    // the cross-facility index; caller holds the write lock and has already updated the bitmap
+    public void touchDays(Types.Facility f, int startMinutes, int endMinutes) {
+        if (endMinutes <= startMinutes) return;                   // empty range touches nothing
+        columns.refresh(f, startMinutes, endMinutes);             // busy bits follow the bitmap
+        int lastDay = (endMinutes - 1) / (24 * 60);               // day of the last booked minute
+        for (int d = startMinutes / (24 * 60); d <= lastDay; d++) {
+            f.dayVersions.incrementAndGet(d);                     // cached payloads for d become stale
+        }
     }
 
-    // Remove all bookings for a facility on a specific day of the week
-    public synchronized int removeBookingsForDay(String facilityName, Types.Day day) {
+    // Remove all bookings for a facility on a specific day of the week; changed days go to changes (nullable)
+    public int removeBookingsForDay(String facilityName, Types.Day day, ChangeSet changes) {
         Types.Facility f = facilities.get(facilityName);     // lookup facility
         if (f == null) return 0;                             // no facility, nothing to remove
-        
-        List<Types.Booking> toRemove = new ArrayList<>();    // collect bookings to remove
-        for (Types.Booking b : f.bookings) {                 // iterate facility bookings
-            if (b.start.day == day) {                         // booking is on specified day
-                toRemove.add(b);                             // mark for removal
+
+        f.lock.writeLock().lock();
+        try {
+            int dayStart = day.value * 24 * 60;                  // first minute of the day
+            int from = f.bookings.lowerBound(dayStart);          // first booking starting that day
+            int to = f.bookings.lowerBound(dayStart + 24 * 60);  // first booking starting the next day
+            for (int i = from; i < to; i++) {
+                bookings.remove(f.bookings.get(i).id);           // remove from global map
+                f.occupancy.clear(f.bookings.startAt(i), f.bookings.endAt(i)); // free its minutes
+                touchDays(f, f.bookings.startAt(i), f.bookings.endAt(i));        // may spill into next day
+                if (changes != null) changes.addRange(f.name, f.bookings.startAt(i), f.bookings.endAt(i));
             }
+            f.bookings.removeRange(from, to);                    // drop the contiguous run from the index
+            return to - from;                                    // return count of removed bookings
+        } finally {
+            f.lock.writeLock().unlock();
         }
-        
-        // Remove collected bookings
-        for (Types.Booking b : toRemove) {
-            bookings.remove(b.id);                           // remove from global map
-            f.bookings.remove(b);                            // remove from facility list
-        }
-        
-        return toRemove.size();                              // return count of removed bookings
     }
 }
@@ -0,0 +1,159 @@
+/*
+ * LatencyStats.java
+ * Purpose: Per-opcode latency histograms of the four request phases (decode, logic, encode,
+ *          send) plus named server counters, served by OP_STATS.
+ * Design notes:
+ * - HDR-style log-linear buckets: values below 32 ns get a bucket each; above, every power of two
+ *   is split into 16 equal buckets, so any recorded value is reported within 1/16 (~6%) of its
+ *   true value. Values are clamped to 2^36 ns (~69 s): 528 buckets per histogram.
+ * - Buckets are AtomicLongArray counters updated by the workers (and by the log writer thread
+ *   for deferred replies); readers take an unsynchronized scan, good enough for monitoring.
+ * - Opcodes 0x0000-0x000F and the two custom ops get their own row; anything else is "other".
+ * - Disabled stats record nothing: workers then use RequestTimer.OFF and never call record().
+ *   Counters (cache, fan-out, log) are read on demand from suppliers registered at startup.
+ * - STATS reply payload: u64 uptimeNs + u16 rowCount + [u16 op + u64 count +
+ *   4 x (u64 p50 + u64 p90 + u64 p99 + u64 p999 + u64 max)]* + u16 counterCount +
+ *   [string name + i64 value]*. Times are nanoseconds; rows with no requests are left out.
+ */
+
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.function.LongSupplier;
+
+public class LatencyStats {
+    public static final int PHASES = 4;                              // decode, logic, encode, send
+    private static final int OTHER = 18;                             // row for unknown opcodes
+    private static final double[] QUANTILES = {0.50, 0.90, 0.99, 0.999};
+
+    // One latency distribution
+    static final class Histogram {
+        private static final int SUB_BITS = 5;                        // 2^SUB_BITS linear buckets at the bottom
+        private static final int HALF = 1 << (SUB_BITS - 1);          // buckets per power of two above that
+        private static final long MAX_VALUE = (1L << 36) - 1;         // clamp
+        static final int BUCKETS = index(MAX_VALUE) + 1;
+
+        private final AtomicLongArray counts = new AtomicLongArray(BUCKETS);
+        private final AtomicLong max = new AtomicLong();
+
+        void record(long nanos) {
+            long v = Math.min(Math.max(nanos, 0), MAX_VALUE);
+            counts.getAndIncrement(index(v));
+            long m;
+            while (v > (m = max.get()) && !max.compareAndSet(m, v)) { } // rarely loops
+        }
+
+        static int index(long v) {
+            if (v < 2 * HALF) return (int) v;                         // exact below 32
+            int shift = 63 - Long.numberOfLeadingZeros(v) - (SUB_BITS - 1); // keeps SUB_BITS top bits
+            return shift * HALF + (int) (v >>> shift);
+        }
+
+        // Largest value that falls into bucket i
+        static long highest(int i) {
+            if (i < 2 * HALF) return i;
+            int shift = i / HALF - 1;
+            long sub = i - shift * HALF;
+            return ((sub + 1) << shift) - 1;
+        }
+
+        // Write the quantiles then the max
+        void write(ByteBuffer out) {
+            long[] c = new long[BUCKETS];
+            long total = 0;
+            for (int i = 0; i < BUCKETS; i++) total += (c[i] = counts.get(i));
+            int i = 0;
+            long seen = 0;
+            for (double q : QUANTILES) {
+                long rank = Math.max(1, (long) Math.ceil(q * total));  // 1-based rank of the quantile
+                while (i < BUCKETS - 1 && seen + c[i] < rank) seen += c[i++];
+                WireCodec.writeI64(out, total == 0 ? 0 : Math.min(highest(i), max.get()));
+            }
+            WireCodec.writeI64(out, max.get());
+        }
+    }
+
+    // A named counter read when STATS is served
+    private static final class Counter {
+        final String name;
+        final LongSupplier value;
+        Counter(String name, LongSupplier value) { this.name = name; this.value = value; }
+    }
+
+    private final boolean enabled;                                   // record latencies
+    private final long startNanos = System.nanoTime();               // uptime origin
+    private final Histogram[][] rows = new Histogram[OTHER + 1][];   // [op row][phase]
+    private final AtomicLongArray requests = new AtomicLongArray(OTHER + 1); // per row
+    private final List<Counter> counters = new ArrayList<>();        // registered before serving
+
+    public LatencyStats(boolean enabled) {
+        this.enabled = enabled;
+        if (!enabled) return;                                         // no histograms to fill
+        for (int r = 0; r <= OTHER; r++) {
+            rows[r] = new Histogram[PHASES];
+            for (int p = 0; p < PHASES; p++) rows[r][p] = new Histogram();
+        }
+    }
+
+    public boolean enabled() { return enabled; }
+
+    // Register a counter for the STATS reply (call during startup, before workers run)
+    public void counter(String name, LongSupplier value) {
+        counters.add(new Counter(name, value));
+    }
+
+    // Record one request's phase times in nanoseconds
+    public void record(int opCode, long decodeNs, long logicNs, long encodeNs, long sendNs) {
+        int r = row(opCode);
+        requests.getAndIncrement(r);
+        Histogram[] h = rows[r];
+        h[0].record(decodeNs);
+        h[1].record(logicNs);
+        h[2].record(encodeNs);
+        h[3].record(sendNs);
+    }
+
+    // Largest payload write() can produce (every row present); bounds a STATS item in a batch
+    public int maxPayloadBytes() {
+        int n = 8 + 2 + (OTHER + 1) * (2 + 8 + PHASES * (QUANTILES.length + 1) * 8) + 2;
+        for (Counter c : counters) n += 2 + c.name.getBytes(java.nio.charset.StandardCharsets.UTF_8).length + 8;
+        return n;
+    }
+
+    // Write the STATS reply payload at out's position
+    public void write(ByteBuffer out) {
+        WireCodec.writeI64(out, System.nanoTime() - startNanos);     // uptime
+        int countAt = out.position();
+        WireCodec.writeU16(out, 0);                                   // rows, patched below
+        int n = 0;
+        for (int r = 0; enabled && r <= OTHER; r++) {
+            if (requests.get(r) == 0) continue;                       // op never seen
+            WireCodec.writeU16(out, op(r));
+            WireCodec.writeI64(out, requests.get(r));
+            for (Histogram h : rows[r]) h.write(out);
+            n++;
+        }
+        out.putShort(countAt, (short) n);
+        WireCodec.writeU16(out, counters.size());
+        for (Counter c : counters) {
+            WireCodec.writeString(out, c.name);
+            WireCodec.writeI64(out, c.value.getAsLong());
+        }
+    }
+
+    private static int row(int op) {
+        if (op < 0x10) return op;
+        if (op == Protocol.OP_CUSTOM_IDEMPOTENT) return 16;
+        if (op == Protocol.OP_CUSTOM_NON_IDEMPOTENT) return 17;
+        return OTHER;
+    }
+
+    private static int op(int row) {
+        if (row < 0x10) return row;
+        if (row == 16) return Protocol.OP_CUSTOM_IDEMPOTENT;
+        if (row == 17) return Protocol.OP_CUSTOM_NON_IDEMPOTENT;
+        return 0xFFFF;                                                // other
+    }
+}
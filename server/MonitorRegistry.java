@@ -3,47 +3,125 @@
  * Purpose: Tracks active monitor registrations for callback notifications.
  * Design notes:
  * - Each monitor entry stores client address/port, facility, and expiry timestamp.
- * - A sweeper removes expired entries.
+ * - Entries are indexed by facility, then by client endpoint (addr:port). Callback senders
+ *   iterate the live per-facility view without copying and skip entries whose lease has run out.
+ * - Re-registering from the same addr:port for the same facility extends the existing lease.
+ * - Expiry uses a min-heap ordered by expiry time holding exactly one node per entry, so its size
+ *   follows the number of monitors however often leases are renewed. Extending a lease only
+ *   updates the entry; when its old node comes due the sweeper re-queues it at the new expiry.
+ *   Shortening a lease (rare) replaces the node. A sweep costs O(k log n) for k due nodes.
+ * - A facility's endpoint map is dropped when its last monitor expires.
+ * - start() runs the sweep once a second on its own daemon thread; each sweep is a
+ *   ServerEvents.CacheSweep flight-recorder event.
  */
 
 import java.net.*;
-import java.util.List;
-import java.util.ArrayList;
+import java.util.Collection;
+import java.util.Collections;
+import java.util.PriorityQueue;
+import java.util.concurrent.ConcurrentHashMap;
 
 public class MonitorRegistry {
+    private static final long SWEEP_INTERVAL_MS = 1000;        // gap between lease sweeps
+
     public static final class Entry {
-        public final InetAddress addr;    // client IP address
-        public final int port;            // client UDP port
-        public final String facility;     // facility being monitored
-        public final long expiryEpochMs;  // expiry timestamp
+        public final InetAddress addr;          // client IP address
+        public final int port;                  // client UDP port
+        public final String facility;           // facility being monitored
+        public volatile long expiryEpochMs;     // expiry timestamp (extended on re-register)
+        private Expiry node;                    // this entry's heap node (guarded by the registry)
         public Entry(InetAddress addr, int port, String facility, long expiryEpochMs) {
             this.addr = addr; this.port = port; this.facility = facility; this.expiryEpochMs = expiryEpochMs;
         }
+        public boolean isActive(long now) { return expiryEpochMs > now; }
+    }
+
+    // Heap node: the expiry an entry had when the node was pushed
+    private static final class Expiry {
+        final long atMs;                        // expiry time at push
+        final InetSocketAddress endpoint;       // subscriber key
+        final Entry entry;                      // subscriber
+        Expiry(long atMs, InetSocketAddress endpoint, Entry entry) { this.atMs = atMs; this.endpoint = endpoint; this.entry = entry; }
     }
 
-    private final List<Entry> entries = new ArrayList<>(); // in-memory list of monitors
+    // facility -> (addr:port -> entry)
+    private final ConcurrentHashMap<String, ConcurrentHashMap<InetSocketAddress, Entry>> byFacility = new ConcurrentHashMap<>();
+    private final PriorityQueue<Expiry> expiries = new PriorityQueue<>((a, b) -> Long.compare(a.atMs, b.atMs)); // guarded by this
+
+    // Sweep expired leases every second on a daemon thread
+    public void start() {
+        Thread t = new Thread(() -> {
+            while (true) {
+                try {
+                    Thread.sleep(SWEEP_INTERVAL_MS);
+                } catch (InterruptedException ie) {
+                    return;                                                  // shutdown
+                }
+                sweepExpired();
+            }
+        }, "monitor-sweep");
+        t.setDaemon(true);
+        t.start();
+    }
 
-    // Register a new monitor entry
+    // Register a monitor, or extend the lease of an existing one from the same endpoint
     public synchronized void register(InetAddress addr, int port, String facility, long durationSeconds) {
         long expiry = System.currentTimeMillis() + durationSeconds * 1000L; // compute expiry time
-        entries.add(new Entry(addr, port, facility, expiry));                // append entry
+        InetSocketAddress endpoint = new InetSocketAddress(addr, port);       // subscriber key
+        ConcurrentHashMap<InetSocketAddress, Entry> subs = byFacility.computeIfAbsent(facility, k -> new ConcurrentHashMap<>());
+        Entry e = subs.get(endpoint);
+        if (e == null) {
+            e = new Entry(addr, port, facility, expiry);                     // new subscriber
+            subs.put(endpoint, e);
+            queue(e, endpoint, expiry);
+        } else {
+            e.expiryEpochMs = expiry;                                        // change lease in place
+            if (expiry < e.node.atMs) {                                      // shorter: node would fire late
+                expiries.remove(e.node);                                     // linear, but only on shortening
+                queue(e, endpoint, expiry);
+            }                                                                // longer: node re-queued when due
+        }
+    }
+
+    private void queue(Entry e, InetSocketAddress endpoint, long atMs) {
+        e.node = new Expiry(atMs, endpoint, e);
+        expiries.add(e.node);
+    }
+
+    // Live view of monitors for a facility; callers must check Entry.isActive(now)
+    public Collection<Entry> getActiveFor(String facility) {
+        ConcurrentHashMap<InetSocketAddress, Entry> subs = byFacility.get(facility);
+        return subs == null ? Collections.<Entry>emptyList() : subs.values(); // no copy
     }
 
-    // Get snapshot of active monitors for a facility
-    public synchronized List<Entry> getActiveFor(String facility) {
+    // Sweep expired entries (pops only heap nodes that are due)
+    public synchronized void sweepExpired() {
+        ServerEvents.CacheSweep event = new ServerEvents.CacheSweep();
+        event.begin();
         long now = System.currentTimeMillis();           // current time
-        List<Entry> out = new ArrayList<>();             // output list
-        for (Entry e : entries) {                        // iterate entries
-            if (e.expiryEpochMs > now && e.facility.equals(facility)) {
-                out.add(e);                              // still active for facility
+        int removed = 0;                                 // leases dropped
+        while (!expiries.isEmpty() && expiries.peek().atMs <= now) {
+            Expiry x = expiries.poll();
+            if (x.entry.expiryEpochMs > now) {                               // lease was extended
+                queue(x.entry, x.endpoint, x.entry.expiryEpochMs);           // still one node per entry
+                continue;
             }
+            ConcurrentHashMap<InetSocketAddress, Entry> subs = byFacility.get(x.entry.facility);
+            if (subs != null && subs.remove(x.endpoint, x.entry)) {
+                removed++;
+                if (subs.isEmpty()) byFacility.remove(x.entry.facility, subs); // register() holds the same lock
+            }
+        }
+        if (event.shouldCommit()) {
+            event.cache = "monitors"; event.removed = removed; event.remaining = size();
+            event.commit();
         }
-        return out;                                      // return active list
     }
 
-    // Sweep expired entries
-    public synchronized void sweepExpired() {
-        long now = System.currentTimeMillis();           // current time
-        entries.removeIf(e -> e.expiryEpochMs <= now);   // remove if expired
+    // Number of registered monitors (including ones not yet swept)
+    public int size() {
+        int n = 0;
+        for (ConcurrentHashMap<InetSocketAddress, Entry> subs : byFacility.values()) n += subs.size();
+        return n;
     }
 }
@@ -0,0 +1,108 @@
+/*
+ * NameTable.java
+ * Purpose: Decodes length-prefixed UTF-8 names (facility, user) straight from a request buffer to
+ *          a shared String, so a name seen before costs no byte[] or String per request, and hands
+ *          back the cached UTF-8 bytes when a name is written into a reply.
+ * Design notes:
+ * - Open-addressing table of immutable entries (UTF-8 bytes + String), probed by a hash of the
+ *   raw bytes; a hit compares the bytes in place (absolute gets, works on direct buffers).
+ * - Lock-free: a slot is filled once by CAS and never changes, so lookups take no lock. Two
+ *   workers inserting the same new name at once may leave a redundant entry; both are correct.
+ * - utf8() looks a String up by the same hash: for ASCII names the char hash equals the byte hash,
+ *   so a cached name is found without encoding it. Other names are encoded once and then cached.
+ * - Bounded: once the table holds its capacity, new names are decoded normally and not cached,
+ *   so a stream of distinct names cannot grow it. Slots are twice the capacity so probes stay short.
+ */
+
+import java.nio.BufferUnderflowException;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicReferenceArray;
+
+public final class NameTable {
+    // One cached name
+    private static final class Name {
+        final byte[] utf8;                                      // encoded form, compared on lookup
+        final String value;                                     // shared decoded form
+        final int hash;                                         // hash of utf8
+        Name(byte[] utf8, String value, int hash) { this.utf8 = utf8; this.value = value; this.hash = hash; }
+    }
+
+    private final AtomicReferenceArray<Name> slots;             // open addressing, linear probing
+    private final int mask;                                     // slots.length() - 1
+    private final int capacity;                                 // most names cached
+    private final AtomicInteger size = new AtomicInteger();     // names cached
+
+    public NameTable(int capacity) {
+        int n = Integer.highestOneBit(Math.max(2, capacity) * 2 - 1) << 1; // power of two >= 2 * capacity
+        this.slots = new AtomicReferenceArray<>(n);
+        this.mask = n - 1;
+        this.capacity = capacity;
+    }
+
+    // Read a u16-length-prefixed UTF-8 string at buf's position (same format as WireCodec.readString)
+    public String read(ByteBuffer buf) {
+        int len = Short.toUnsignedInt(buf.getShort());          // uint16 length
+        if (len > buf.remaining()) throw new BufferUnderflowException();
+        int pos = buf.position();
+        int h = hash(buf, pos, len);
+        for (int i = h & mask; ; i = (i + 1) & mask) {
+            Name n = slots.get(i);
+            if (n == null) break;                               // not cached
+            if (n.hash == h && n.utf8.length == len && matches(n.utf8, buf, pos)) {
+                buf.position(pos + len);                        // consume without copying
+                return n.value;
+            }
+        }
+        byte[] bytes = new byte[len];                           // first sighting: decode once
+        buf.get(bytes);
+        String value = new String(bytes, StandardCharsets.UTF_8);
+        if (size.get() < capacity) insert(new Name(bytes, value, h));
+        return value;
+    }
+
+    // UTF-8 bytes of a name (shared, do not modify); cached like a decoded name on first use
+    public byte[] utf8(String value) {
+        byte[] bytes = null;                                    // encoded only when needed
+        int h = value.length();
+        for (int i = 0; i < value.length(); i++) {
+            char c = value.charAt(i);
+            if (c >= 0x80) { bytes = value.getBytes(StandardCharsets.UTF_8); break; } // not ASCII
+            h = 31 * h + c;                                     // ASCII: same as hashing the bytes
+        }
+        h = bytes == null ? h ^ (h >>> 16) : hash(ByteBuffer.wrap(bytes), 0, bytes.length);
+        for (int i = h & mask; ; i = (i + 1) & mask) {
+            Name n = slots.get(i);
+            if (n == null) break;                               // not cached
+            if (n.hash == h && n.value.equals(value)) return n.utf8;
+        }
+        if (bytes == null) bytes = value.getBytes(StandardCharsets.UTF_8); // first sighting: encode once
+        if (size.get() < capacity) insert(new Name(bytes, value, h));
+        return bytes;
+    }
+
+    public int size() { return size.get(); }
+
+    private void insert(Name name) {
+        for (int i = name.hash & mask; ; i = (i + 1) & mask) {
+            if (slots.compareAndSet(i, null, name)) {
+                size.incrementAndGet();
+                return;
+            }
+        }
+    }
+
+    private static boolean matches(byte[] utf8, ByteBuffer buf, int pos) {
+        for (int i = 0; i < utf8.length; i++) {
+            if (utf8[i] != buf.get(pos + i)) return false;
+        }
+        return true;
+    }
+
+    private static int hash(ByteBuffer buf, int pos, int len) {
+        int h = len;
+        for (int i = 0; i < len; i++) h = 31 * h + buf.get(pos + i);
+        return h ^ (h >>> 16);                                  // spread high bits into the index
+    }
+}
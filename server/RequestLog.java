@@ -0,0 +1,170 @@
+/*
+ * RequestLog.java
+ * Purpose: Per-request log that costs the receive path a few stores instead of a println:
+ *          workers put fixed-size binary records into a ring, a background thread formats them.
+ * Design notes:
+ * - Record (5 longs, 40 bytes): requestId | op << 32 | status << 48; IPv4 address << 32 |
+ *   port << 8 | flags; receive time (System.nanoTime); route ns; send ns. status is the reply
+ *   opCode (error bit set on failure); flags mark a deferred (log-durable) send, a reply dropped
+ *   by --lossSim and a non-IPv4 client (address not recorded).
+ * - Lock-free bounded ring, many producers and one consumer: producers claim a slot by CAS on the
+ *   tail, write the record, then publish it by advancing the slot's sequence number; the consumer
+ *   reads only published slots. Workers and the log writer thread (deferred replies) both produce.
+ * - Full ring: the new record is dropped and counted; nothing blocks or waits. The formatter
+ *   reports the count of records lost since its last report, so gaps are visible in the output.
+ * - Sampling: workers log one request in every --logSample (counted per worker, no RNG).
+ * - The "request-log" thread drains in batches and either prints text lines (one print per batch)
+ *   or, with --logFile, appends the raw 40-byte big-endian records to that file.
+ */
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.concurrent.locks.LockSupport;
+
+public class RequestLog {
+    public static final int DEFAULT_CAPACITY = 1 << 16;          // records the ring holds
+    public static final int FLAG_DEFERRED = 1;                   // reply waited for the write-ahead log
+    public static final int FLAG_LOSS = 2;                       // reply dropped by --lossSim
+    public static final int FLAG_NOT_IPV4 = 4;                   // client address not recorded
+    private static final int WORDS = 5;                          // longs per record
+    private static final long IDLE_PARK_NANOS = 1_000_000;       // consumer sleep when the ring is empty
+
+    private final long[] data;                                   // records, WORDS longs per slot
+    private final AtomicLongArray sequence;                      // slot i is readable when == pos + 1
+    private final int mask;                                      // slots - 1
+    private final AtomicLong tail = new AtomicLong();            // next position to claim
+    private long head;                                           // next position to read (consumer only)
+    private final int sampleEvery;                               // log 1 in N requests
+    private final Path file;                                     // binary output (null: text to stdout)
+    private final LongAdder written = new LongAdder();           // records formatted or persisted
+    private final LongAdder dropped = new LongAdder();           // records lost to a full ring
+    private long droppedReported;                                // consumer only
+
+    public RequestLog(int capacity, int sampleEvery, Path file) {
+        int slots = Integer.highestOneBit(Math.max(2, capacity) * 2 - 1); // power of two >= capacity
+        this.data = new long[slots * WORDS];
+        this.sequence = new AtomicLongArray(slots);
+        for (int i = 0; i < slots; i++) sequence.set(i, i);     // slot i first takes position i
+        this.mask = slots - 1;
+        this.sampleEvery = Math.max(1, sampleEvery);
+        this.file = file;
+    }
+
+    public int sampleEvery() { return sampleEvery; }
+
+    // Start the background formatter
+    public void start() throws IOException {
+        FileChannel out = file == null ? null : FileChannel.open(file,
+                StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.APPEND);
+        Thread t = new Thread(() -> drainLoop(out), "request-log");
+        t.setDaemon(true);
+        t.start();
+    }
+
+    // Record one request; never blocks. Returns false if the ring was full (the record is dropped).
+    public boolean record(long requestId, int op, int status, java.net.InetAddress addr, int port, int flags,
+                          long receivedNanos, long routeNanos, long sendNanos) {
+        long pos;
+        int slot;
+        while (true) {
+            pos = tail.get();
+            slot = (int) pos & mask;
+            long seq = sequence.get(slot);
+            if (seq == pos) {
+                if (tail.compareAndSet(pos, pos + 1)) break;     // slot claimed
+            } else if (seq < pos) {
+                dropped.increment();                             // consumer has not freed it: full
+                return false;
+            }                                                    // else another producer took it; retry
+        }
+        long ip = 0;
+        if (addr instanceof java.net.Inet4Address) ip = addr.hashCode() & 0xFFFFFFFFL; // IPv4 hash is the address
+        else flags |= FLAG_NOT_IPV4;
+        int base = slot * WORDS;
+        data[base] = (requestId & 0xFFFFFFFFL) | ((long) (op & 0xFFFF) << 32) | ((long) (status & 0xFFFF) << 48);
+        data[base + 1] = (ip << 32) | ((long) (port & 0xFFFF) << 8) | (flags & 0xFF);
+        data[base + 2] = receivedNanos;
+        data[base + 3] = routeNanos;
+        data[base + 4] = sendNanos;
+        sequence.lazySet(slot, pos + 1);                         // publish (orders the plain writes above)
+        return true;
+    }
+
+    private void drainLoop(FileChannel out) {
+        StringBuilder text = new StringBuilder(64 * 1024);       // one print per batch
+        ByteBuffer bin = ByteBuffer.allocate(WORDS * 8 * 1024);  // one write per batch
+        while (true) {
+            int n = 0;
+            while (n < 1024) {
+                int slot = (int) head & mask;
+                if (sequence.get(slot) != head + 1) break;       // not published yet
+                int base = slot * WORDS;
+                if (out != null) {
+                    for (int w = 0; w < WORDS; w++) bin.putLong(data[base + w]);
+                } else {
+                    format(text, base);
+                }
+                sequence.lazySet(slot, head + mask + 1);         // free the slot for the next lap
+                head++;
+                n++;
+            }
+            long lost = dropped.sum();
+            if (lost != droppedReported && out == null) {
+                text.append("[log] ").append(lost - droppedReported).append(" records dropped (ring full)\n");
+            }
+            droppedReported = lost;
+            if (n == 0 && text.length() == 0) {
+                LockSupport.parkNanos(IDLE_PARK_NANOS);          // nothing to do
+                continue;
+            }
+            written.add(n);
+            try {
+                if (out != null) {
+                    bin.flip();
+                    while (bin.hasRemaining()) out.write(bin);
+                    bin.clear();
+                } else {
+                    System.out.print(text);
+                    text.setLength(0);
+                }
+            } catch (IOException ioe) {
+                System.out.println("[log] write failed: " + ioe.getMessage()); // keep serving
+                bin.clear();
+            }
+        }
+    }
+
+    // One text line per record
+    private void format(StringBuilder sb, int base) {
+        long w0 = data[base], w1 = data[base + 1];
+        int flags = (int) (w1 & 0xFF);
+        sb.append("req id=").append(w0 & 0xFFFFFFFFL)
+          .append(" op=0x").append(Long.toHexString((w0 >>> 32) & 0xFFFF))
+          .append(" status=0x").append(Long.toHexString(w0 >>> 48))
+          .append(" client=");
+        if ((flags & FLAG_NOT_IPV4) != 0) {
+            sb.append('?');
+        } else {
+            long ip = w1 >>> 32;
+            sb.append(ip >>> 24).append('.').append((ip >>> 16) & 0xFF).append('.')
+              .append((ip >>> 8) & 0xFF).append('.').append(ip & 0xFF);
+        }
+        sb.append(':').append((w1 >>> 8) & 0xFFFF)
+          .append(" atMs=").append(data[base + 2] / 1_000_000)
+          .append(" routeUs=").append(data[base + 3] / 1000)
+          .append(" sendUs=").append(data[base + 4] / 1000);
+        if ((flags & FLAG_DEFERRED) != 0) sb.append(" deferred");
+        if ((flags & FLAG_LOSS) != 0) sb.append(" [LOSS] response dropped");
+        sb.append('\n');
+    }
+
+    // Metrics
+    public long written() { return written.sum(); }
+    public long dropped() { return dropped.sum(); }
+}
@@ -1,204 +1,452 @@
 /*
  * RequestRouter.java
  * Purpose: Parses UDP requests, routes to business logic, applies at-most-once cache,
- *          and builds responses. Also emits monitor callbacks.
+ *          and builds responses. Also builds monitor callback messages.
  * Design notes:
  * - Stateless decode/encode with WireCodec; minimal shared state via dependencies.
- * - At-most-once: cache maps requestId to response bytes for a short TTL.
+ * - At-most-once: AtMostOnceCache maps (client addr, port, requestId) to response bytes for a
+ *   short TTL, bounded in size and expired by its own thread. The key is reserved before the
+ *   request runs, so a retransmit reaching another worker meanwhile is dropped, not re-executed.
+ * - Mutating handlers report the exact (facility, day) pairs they changed through a ChangeSet;
+ *   replies served from the at-most-once cache report nothing (callbacks were already sent).
+ * - OP_BATCH runs each sub-request through the same dispatch as a standalone request and packs
+ *   the sub-replies into one datagram; the batch reply is cached as a unit.
+ * - Handlers decode from the caller's buffer (a worker's direct receive buffer) without copying
+ *   the payload; batch items are views of the same buffer. Facility and user names come from a
+ *   shared NameTable, so a known name costs no byte[] or String.
+ * - Handlers mark the end of decoding and of the logic on the caller's RequestTimer, feeding
+ *   the per-opcode latency histograms that OP_STATS returns (RequestTimer.OFF when disabled).
+ * - Replies are encoded straight into the caller's (pooled, direct) reply buffer: the header is
+ *   written in place and its length patched at the end. Only at-most-once copies the reply out,
+ *   at its exact length, because the buffer is reused for the next request.
+ * - No router-wide lock: facility state is striped in FacilityStore, and the cache and usage
+ *   counters are concurrent, so requests on different facilities run in parallel.
  */
 
 import java.net.*;
 import java.nio.*;
-import java.util.Map;
-import java.util.HashMap;
 import java.util.List;
 
 public class RequestRouter {
     private final ReservationLogic logic;            // business logic
     private final MonitorRegistry monitors;          // registry for callbacks
+    private final AvailabilityCache availability;    // encoded QUERY_AVAIL payloads
+    private final AtMostOnceCache amoCache;          // (addr, port, requestId) -> cached response
+    private final NameTable names = new NameTable(NAME_TABLE_CAPACITY); // decoded facility/user names
+    private final LatencyStats stats;                // per-opcode latency histograms (OP_STATS)
 
+    public static final int DEFAULT_AMO_MAX_ENTRIES = 100_000; // default at-most-once cache bound
+    private static final int NAME_TABLE_CAPACITY = 1 << 16;    // distinct names decoded without allocating
 
-    // Simple at-most-once cache entry
-    private static final class CacheEntry {
-        final byte[] response;   // full datagram response bytes
-        final long expiryMs;     // expiry timestamp for LRU/TTL
-        CacheEntry(byte[] response, long expiryMs) { this.response = response; this.expiryMs = expiryMs; }
+    public RequestRouter(ReservationLogic logic, MonitorRegistry monitors, long cacheTtlMs) {
+        this(logic, monitors, cacheTtlMs, DEFAULT_AMO_MAX_ENTRIES);
     }
 
-    private final Map<Long, CacheEntry> amoCache = new HashMap<>(); // requestId -> cached response
-    private final long cacheTtlMs;                                   // cache time to live
+    public RequestRouter(ReservationLogic logic, MonitorRegistry monitors, long cacheTtlMs, int amoMaxEntries) {
+        this(logic, monitors, cacheTtlMs, amoMaxEntries, new LatencyStats(false));
+    }
 
-    public RequestRouter(ReservationLogic logic, MonitorRegistry monitors, long cacheTtlMs) {
-        this.logic = logic; this.monitors = monitors; this.cacheTtlMs = cacheTtlMs; // assign dependencies
+    public RequestRouter(ReservationLogic logic, MonitorRegistry monitors, long cacheTtlMs, int amoMaxEntries, LatencyStats stats) {
+        this.logic = logic; this.monitors = monitors; this.stats = stats;            // assign dependencies
+        this.availability = new AvailabilityCache(logic);                            // availability cache
+        this.amoCache = new AtMostOnceCache(cacheTtlMs, amoMaxEntries);              // reply cache
+    }
+
+    // Availability cache (hit/miss counters)
+    public AvailabilityCache availability() {
+        return availability;
+    }
+
+    // At-most-once reply cache (start() for expiry, occupancy/eviction/hit metrics)
+    public AtMostOnceCache amoCache() {
+        return amoCache;
     }
 
-    // Sweep at-most-once cache
-    public synchronized void sweepCache() {
-        long now = System.currentTimeMillis();                             // current time
-        amoCache.entrySet().removeIf(e -> e.getValue().expiryMs <= now);   // remove expired
+    // Latency histograms recorded by the workers and served by OP_STATS
+    public LatencyStats stats() {
+        return stats;
     }
 
-    // Handle a single request and return a response datagram
-    public synchronized byte[] handle(InetAddress clientAddr, int clientPort, byte[] request, boolean atMostOnceFlag)
+    // Handle a single request and return a response datagram, empty for a dropped duplicate (changed days are not reported)
+    public byte[] handle(InetAddress clientAddr, int clientPort, byte[] request, boolean atMostOnceFlag) {
+        return handle(clientAddr, clientPort, request, atMostOnceFlag, null);
+    }
+
+    // Handle a single request and return a response datagram; changed days are added to changes (nullable)
+    public byte[] handle(InetAddress clientAddr, int clientPort, byte[] request, boolean atMostOnceFlag, ChangeSet changes)
     {
-        ByteBuffer in = WireCodec.wrap(request);                           // wrap input buffer
+        ByteBuffer out = WireCodec.acquireMessageBuffer();                 // pooled reply buffer
+        try {
+            handle(clientAddr, clientPort, WireCodec.wrap(request), out, changes);
+            byte[] response = new byte[out.remaining()];                   // callers wanting an array get a copy
+            out.get(response);
+            return response;
+        } finally {
+            WireCodec.releaseMessageBuffer(out);
+        }
+    }
+
+    // Handle the request datagram between in's position and limit (e.g. a worker's receive buffer)
+    // and write the reply into out, which is cleared first and left flipped (ready to send). out is
+    // left empty when the request is a duplicate another worker is still running (send nothing).
+    // Handlers decode straight from in and encode straight into out; nothing is copied except a
+    // reply that at-most-once has to remember. in is consumed.
+    public void handle(InetAddress clientAddr, int clientPort, ByteBuffer in, ByteBuffer out, ChangeSet changes) {
+        handle(clientAddr, clientPort, in, out, changes, RequestTimer.OFF);
+    }
+
+    // As above, marking the decode/logic/encode phases on timer (started by the caller)
+    public void handle(InetAddress clientAddr, int clientPort, ByteBuffer in, ByteBuffer out, ChangeSet changes, RequestTimer timer) {
+        out.clear();
         WireCodec.Header hdr = WireCodec.readHeader(in);                   // parse header
-        byte[] payload = new byte[hdr.payloadLen];                         // payload bytes array
-        in.get(payload);                                                   // copy payload
-
-        // If at-most-once and cached, return cached response
-        CacheEntry cached = null;                                          // holder
-        if ((hdr.flags & Protocol.FLAG_AT_MOST_ONCE) != 0) {               // check flag bit
-            cached = amoCache.get(hdr.requestId);                          // lookup cache
-            if (cached != null) return cached.response;                    // return cached response directly
+        if (hdr.payloadLen > in.remaining()) throw new BufferUnderflowException(); // truncated datagram
+        ByteBuffer payload = in;                                           // payload view, no copy
+        payload.limit(payload.position() + hdr.payloadLen);                // trailing bytes are ignored
+
+        // If at-most-once, claim the request id; a cached reply is replayed, a running one dropped
+        boolean amo = (hdr.flags & Protocol.FLAG_AT_MOST_ONCE) != 0;      // check flag bit
+        if (amo) {
+            AtMostOnceCache.Entry cached = amoCache.reserve(clientAddr, clientPort, hdr.requestId); // atomic claim
+            if (cached != null) {
+                if (!cached.inFlight()) {
+                    if (changes != null) changes.setLsn(cached.lsn);       // still wait for the original's log record
+                    out.put(cached.response);                              // replay the cached bytes
+                }                                                          // else another worker runs it: no reply
+                out.flip();
+                timer.encoded();
+                return;
+            }
         }
 
-        // Route by opCode
-        byte[] response;
+        boolean done = false;
+        try {
+            dispatch(clientAddr, clientPort, hdr, payload, out, changes, timer); // route by opCode
+            done = true;
+        } finally {
+            if (amo && !done) amoCache.abandon(clientAddr, clientPort, hdr.requestId); // let a retransmit run it
+        }
+        out.flip();
+        timer.encoded();                                                   // reply complete
+
+        // Store in at-most-once cache if requested (replaces the in-flight marker)
+        if (amo) {
+            byte[] response = new byte[out.remaining()];                   // exactly the datagram, nothing more
+            out.get(response).rewind();
+            amoCache.put(clientAddr, clientPort, hdr.requestId, response, changes == null ? 0 : changes.lsn()); // cache response
+        }
+    }
+
+    // Route one request (or batch item) by opCode, writing its reply at out's position; handler
+    // exceptions discard whatever the handler wrote and become error replies
+    private void dispatch(InetAddress clientAddr, int clientPort, WireCodec.Header hdr, ByteBuffer payload, ByteBuffer out,
+                          ChangeSet changes, RequestTimer timer) {
+        int start = out.position();                                        // reply starts here
         try {
             switch (hdr.opCode) {
                 case Protocol.OP_QUERY_AVAIL:
-                    response = onQuery(clientAddr, clientPort, hdr, payload); break; // handle query
+                    onQuery(clientAddr, clientPort, hdr, payload, out, timer); break;                  // handle query
                 case Protocol.OP_BOOK:
-                    response = onBook(clientAddr, clientPort, hdr, payload); break;  // handle booking
+                    onBook(clientAddr, clientPort, hdr, payload, out, changes, timer); break;          // handle booking
                 case Protocol.OP_CHANGE_BOOKING:
-                    response = onChange(clientAddr, clientPort, hdr, payload); break;// handle change
+                    onChange(clientAddr, clientPort, hdr, payload, out, changes, timer); break;        // handle change
                 case Protocol.OP_MONITOR:
-                    response = onMonitor(clientAddr, clientPort, hdr, payload); break;// handle monitor
+                    onMonitor(clientAddr, clientPort, hdr, payload, out, timer); break;                // handle monitor
+                case Protocol.OP_QUERY_WEEK:
+                    onQueryWeek(clientAddr, clientPort, hdr, payload, out, timer); break;              // handle week query
+                case Protocol.OP_FIND_FREE:
+                    onFindFree(clientAddr, clientPort, hdr, payload, out, timer); break;               // handle slot search
+                case Protocol.OP_FIND_ROOMS:
+                    onFindRooms(clientAddr, clientPort, hdr, payload, out, timer); break;              // handle room search
+                case Protocol.OP_STATS:
+                    onStats(hdr, out, timer); break;                                                    // latency stats
+                case Protocol.OP_BATCH:
+                    onBatch(clientAddr, clientPort, hdr, payload, out, changes, timer); break;         // handle batch
                 case Protocol.OP_CUSTOM_IDEMPOTENT:
-                    response = onCustomIdem(clientAddr, clientPort, hdr, payload); break; // idempotent
+                    onCustomIdem(clientAddr, clientPort, hdr, payload, out, changes, timer); break;    // idempotent
                 case Protocol.OP_CUSTOM_NON_IDEMPOTENT:
-                    response = onCustomNonIdem(clientAddr, clientPort, hdr, payload); break; // non-idempotent
+                    onCustomNonIdem(clientAddr, clientPort, hdr, payload, out, changes, timer); break; // non-idempotent
                 default:
-                    response = error(hdr, Protocol.ERR_BAD_REQUEST, "unknown opcode"); // error for unknown
+                    error(out, hdr, Protocol.ERR_BAD_REQUEST, "unknown opcode");                // error for unknown
             }
         } catch (Exception ex) {
-            response = error(hdr, Protocol.ERR_INTERNAL, ex.getMessage() == null ? "error" : ex.getMessage()); // generic error
+            out.clear().position(start);                                   // drop a partly written reply
+            error(out, hdr, Protocol.ERR_INTERNAL, ex.getMessage() == null ? "error" : ex.getMessage()); // generic error
         }
+    }
 
-        // Store in at-most-once cache if requested
-        if ((hdr.flags & Protocol.FLAG_AT_MOST_ONCE) != 0) {
-            amoCache.put(hdr.requestId, new CacheEntry(response, System.currentTimeMillis() + cacheTtlMs)); // cache response
-        }
-        return response; // return encoded response
-    }
-
-    // Build an error response buffer for given header
-    private byte[] error(WireCodec.Header reqHdr, int errCode, String message) {
-        byte[] msgBytes = message.getBytes(java.nio.charset.StandardCharsets.UTF_8); // encode message
-        int payloadLen = 2 + 2 + msgBytes.length;                                    // uint16 err + str(u16+bytes)
-        ByteBuffer out = WireCodec.newMessageBuffer(payloadLen);                     // allocate buffer
-        WireCodec.Header h = new WireCodec.Header();                                 // new header
-        h.version = Protocol.VERSION;                                                // version
-        h.opCode = (reqHdr.opCode | Protocol.OP_ERROR_MASK) & 0xFFFF;               // error opcode
-        h.requestId = reqHdr.requestId;                                             // same request id
-        h.flags = reqHdr.flags;                                                     // same flags
-        h.payloadLen = payloadLen;                                                  // payload length
-        WireCodec.writeHeader(out, h);                                              // write header
+    // Build a monitor callback: QUERY_AVAIL header flagged as callback + u16 count + u8 day + intervals
+    public byte[] buildCallback(String facility, Types.Day day) {
+        byte[] body = availability.payload(facility, day);                          // cached u16 count + intervals
+        ByteBuffer out = WireCodec.newMessageBuffer(body.length + 1);               // plus day byte after the count
+        WireCodec.writeHeader(out, Protocol.OP_QUERY_AVAIL, 0, Protocol.FLAG_IS_CALLBACK, body.length + 1); // no dedupe id
+        out.put(body, 0, 2);                                                        // u16 count
+        out.put((byte) day.value);                                                  // write day
+        out.put(body, 2, body.length - 2);                                          // intervals
+        return out.array();                                                         // shared by every subscriber
+    }
+
+    // Write an error reply for the given request header at out's position
+    private static void error(ByteBuffer out, WireCodec.Header reqHdr, int errCode, String message) {
+        int start = WireCodec.beginMessage(out, reqHdr.opCode | Protocol.OP_ERROR_MASK, reqHdr.requestId, reqHdr.flags); // error opcode
         WireCodec.writeU16(out, errCode);                                           // write error code
-        WireCodec.writeString(out, message);                                        // write message
-        return out.array();                                                         // return bytes
+        if (message.length() > MAX_ERROR_CHARS) message = message.substring(0, MAX_ERROR_CHARS); // bounded reply
+        WireCodec.writeString(out, message);                                        // message encoded once
+        WireCodec.endMessage(out, start);                                           // patch payload length
     }
 
     // Helpers: parse a date (ms) or truncate to day as needed are kept external to router for simplicity (client will send ms).
 
     // onQuery: req payload = string facility + uint8 day; resp = u16 count + [WeeklyTime start,WeeklyTime end]*
-    private byte[] onQuery(InetAddress addr, int port, WireCodec.Header reqHdr, byte[] payload) {
-        ByteBuffer in = WireCodec.wrap(payload);                   // wrap payload
-        String facility = WireCodec.readString(in);                // read facility
+    private void onQuery(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, RequestTimer timer) {
+        String facility = names.read(in);                          // read facility
         int dayValue = Byte.toUnsignedInt(in.get());               // read day (0-6)
         Types.Day day = Types.Day.fromValue(dayValue);             // convert to enum
-        List<Types.Interval> ivals = logic.queryDay(facility, day); // business call
-
-        int count = ivals.size();                                  // number of intervals
-        int payloadLen = 2 + count * 6;                            // u16 count + each has 2x WeeklyTime (3 bytes each)
-        ByteBuffer out = WireCodec.newMessageBuffer(payloadLen);   // allocate
-        WireCodec.Header h = new WireCodec.Header();               // header
-        h.version = Protocol.VERSION; h.opCode = reqHdr.opCode; h.requestId = reqHdr.requestId; h.flags = reqHdr.flags; h.payloadLen = payloadLen; // fill
-        WireCodec.writeHeader(out, h);                             // write header
-        WireCodec.writeU16(out, count);                            // write count
-        for (Types.Interval iv : ivals) {                          // for each interval
-            WireCodec.writeWeeklyTime(out, iv.start);              // write start time
-            WireCodec.writeWeeklyTime(out, iv.end);                // write end time
+        timer.facility(facility);
+        timer.decoded();
+        byte[] body = availability.payload(facility, day);         // cached or freshly encoded payload
+        timer.computed();
+        timer.results((body.length - 2) / 6);                      // intervals in the payload
+
+        WireCodec.writeHeader(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags, body.length); // header
+        out.put(body);                                             // copy encoded intervals
+    }
+
+    // onQueryWeek: req payload = string facility + WeeklyTime from + WeeklyTime to; resp = u16 count +
+    // [WeeklyTime start,WeeklyTime end]* in time order, split per day. Monday 00:00 to Sunday 23:59
+    // returns the whole week, i.e. what seven QUERY_AVAIL calls would return, in one reply.
+    private void onQueryWeek(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, RequestTimer timer) {
+        String facility = names.read(in);                          // read facility
+        int from = WireCodec.readWeekMinutes(in);                  // range start
+        int to = WireCodec.readWeekMinutes(in);                    // range end (exclusive)
+        timer.facility(facility);
+        if (to <= from) { error(out, reqHdr, Protocol.ERR_BAD_REQUEST, "empty range"); return; }
+        timer.decoded();
+        List<Types.Interval> free = logic.queryRange(facility, from, to); // single pass
+        timer.computed();
+        timer.results(free.size());
+
+        int start = WireCodec.beginMessage(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags); // header
+        AvailabilityCache.encode(free, out);                       // intervals
+        WireCodec.endMessage(out, start);                          // patch payload length
+    }
+
+    // onFindFree: req payload = string facility + u16 minMinutes + u16 maxResults + WeeklyTime from +
+    // WeeklyTime to; resp = u16 count + [WeeklyTime start,WeeklyTime end]* listing the first free runs
+    // of at least minMinutes in the window, earliest first. The earliest fitting slot of each run
+    // is [start, start + minMinutes).
+    private void onFindFree(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, RequestTimer timer) {
+        String facility = names.read(in);                          // read facility
+        int minMinutes = WireCodec.readU16(in);                    // required length
+        int maxResults = WireCodec.readU16(in);                    // runs wanted
+        int from = WireCodec.readWeekMinutes(in);                  // window start
+        int to = WireCodec.readWeekMinutes(in);                    // window end (exclusive)
+        timer.facility(facility);
+        if (minMinutes == 0 || maxResults == 0 || to <= from) {
+            error(out, reqHdr, Protocol.ERR_BAD_REQUEST, "bad search");
+            return;
+        }
+        timer.decoded();
+        List<Types.Interval> runs = logic.findFree(facility, from, to, minMinutes, maxResults); // search
+        timer.computed();
+        timer.results(runs.size());
+
+        int start = WireCodec.beginMessage(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags); // header
+        AvailabilityCache.encode(runs, out);                       // runs
+        WireCodec.endMessage(out, start);                          // patch payload length
+    }
+
+    // onFindRooms: req payload = WeeklyTime from + WeeklyTime to + u16 maxResults; resp = u16 count +
+    // u8 truncated + string name* listing facilities with nothing booked in [from, to). truncated is 1
+    // when more facilities matched than maxResults or than fit in one datagram.
+    private void onFindRooms(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, RequestTimer timer) {
+        int from = WireCodec.readWeekMinutes(in);                  // range start
+        int to = WireCodec.readWeekMinutes(in);                    // range end (exclusive)
+        int maxResults = WireCodec.readU16(in);                    // names wanted
+        if (maxResults == 0 || to <= from) { error(out, reqHdr, Protocol.ERR_BAD_REQUEST, "bad search"); return; }
+        timer.decoded();
+        List<String> rooms = logic.findRooms(from, to, maxResults + 1); // one extra detects truncation
+        timer.computed();
+        timer.results(Math.min(rooms.size(), maxResults));         // before the datagram limit
+
+        int start = WireCodec.beginMessage(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags); // header
+        int limit = Math.min(start + Protocol.MAX_DATAGRAM, out.limit()); // one datagram, or a batch item's room
+        WireCodec.writeU16(out, 0);                                // count, patched below
+        out.put((byte) 0);                                         // truncated, patched below
+        int count = 0;
+        for (String room : rooms) {
+            byte[] nb = names.utf8(room);                          // cached bytes, no per-reply encoding
+            if (count == maxResults || out.position() + 2 + nb.length > limit) break; // result or datagram limit
+            WireCodec.writeU16(out, nb.length);                    // facility name
+            out.put(nb);
+            count++;
         }
-        return out.array();                                        // return buffer bytes
+        out.putShort(start + Protocol.HEADER_LEN, (short) count);  // final count
+        out.put(start + Protocol.HEADER_LEN + 2, (byte) (count < rooms.size() ? 1 : 0)); // more matched than returned
+        WireCodec.endMessage(out, start);                          // patch payload length
     }
 
     // onBook: req payload = str facility + str user + WeeklyTime start + WeeklyTime end; resp = i64 bookingId
-    private byte[] onBook(InetAddress addr, int port, WireCodec.Header reqHdr, byte[] payload) throws ReservationLogic.ConflictException {
-        ByteBuffer in = WireCodec.wrap(payload);                   // wrap
-        String facility = WireCodec.readString(in);                // facility
-        String user = WireCodec.readString(in);                    // user
-        Types.WeeklyTime start = WireCodec.readWeeklyTime(in);     // start time
-        Types.WeeklyTime end = WireCodec.readWeeklyTime(in);       // end time
-        long id = logic.book(facility, user, start, end);          // attempt booking
-        ByteBuffer out = WireCodec.newMessageBuffer(8);            // payload length 8 for i64
-        WireCodec.Header h = new WireCodec.Header();               // header
-        h.version = Protocol.VERSION; h.opCode = reqHdr.opCode; h.requestId = reqHdr.requestId; h.flags = reqHdr.flags; h.payloadLen = 8; // fill
-        WireCodec.writeHeader(out, h);                             // write header
+    private void onBook(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, ChangeSet changes, RequestTimer timer) throws ReservationLogic.ConflictException {
+        String facility = names.read(in);                          // facility
+        String user = names.read(in);                              // user
+        int start = WireCodec.readWeekMinutes(in);                 // start week minute
+        int end = WireCodec.readWeekMinutes(in);                   // end week minute
+        timer.facility(facility);
+        timer.decoded();
+        long id = logic.book(facility, user, start, end, changes); // attempt booking
+        timer.computed();
+        WireCodec.writeHeader(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags, 8); // payload length 8 for i64
         WireCodec.writeI64(out, id);                               // write id
-        // Notify monitors about availability change for this facility via callbacks would be sent by server main loop using monitors registry.
-        return out.array();                                        // return response bytes
     }
 
     // onChange: req payload = i64 bookingId + i32 offsetMinutes; resp = WeeklyTime start + WeeklyTime end
-    private byte[] onChange(InetAddress addr, int port, WireCodec.Header reqHdr, byte[] payload) throws ReservationLogic.NotFoundException, ReservationLogic.ConflictException {
-        ByteBuffer in = WireCodec.wrap(payload);                   // wrap
+    private void onChange(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, ChangeSet changes, RequestTimer timer) throws ReservationLogic.NotFoundException, ReservationLogic.ConflictException {
         long bookingId = WireCodec.readI64(in);                    // id
         int offsetMinutes = (int) WireCodec.readU32(in);           // read as uint32 -> int
-        Types.Interval updated = logic.change(bookingId, offsetMinutes); // apply change
-        ByteBuffer out = WireCodec.newMessageBuffer(6);            // two WeeklyTime values (3 bytes each)
-        WireCodec.Header h = new WireCodec.Header();               // header
-        h.version = Protocol.VERSION; h.opCode = reqHdr.opCode; h.requestId = reqHdr.requestId; h.flags = reqHdr.flags; h.payloadLen = 6; // fill
-        WireCodec.writeHeader(out, h);                             // write
-        WireCodec.writeWeeklyTime(out, updated.start);             // start time
-        WireCodec.writeWeeklyTime(out, updated.end);               // end time
-        return out.array();                                        // bytes
+        timer.decoded();
+        Types.Interval updated = logic.change(bookingId, offsetMinutes, changes); // apply change
+        timer.computed();
+        WireCodec.writeHeader(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags, 6); // two WeeklyTime values (3 bytes each)
+        WireCodec.writeWeekMinutes(out, updated.start);            // start time
+        WireCodec.writeWeekMinutes(out, updated.end);              // end time
     }
 
     // onMonitor: req payload = str facility + u32 windowSeconds + u32 clientCallbackPort; resp = u16 ok(=1)
-    private byte[] onMonitor(InetAddress addr, int port, WireCodec.Header reqHdr, byte[] payload) {
-        ByteBuffer in = WireCodec.wrap(payload);                   // wrap
-        String facility = WireCodec.readString(in);                // facility
+    private void onMonitor(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, RequestTimer timer) {
+        String facility = names.read(in);                          // facility
         long windowSeconds = WireCodec.readU32(in);                // requested window seconds
         int callbackPort = (int) WireCodec.readU32(in);            // client callback UDP port
+        timer.facility(facility);
+        timer.decoded();
         monitors.register(addr, callbackPort, facility, windowSeconds); // register monitor
-        ByteBuffer out = WireCodec.newMessageBuffer(2);            // ok flag
-        WireCodec.Header h = new WireCodec.Header();               // header
-        h.version = Protocol.VERSION; h.opCode = reqHdr.opCode; h.requestId = reqHdr.requestId; h.flags = reqHdr.flags; h.payloadLen = 2; // fill
-        WireCodec.writeHeader(out, h);                             // write header
+        timer.computed();
+        WireCodec.writeHeader(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags, 2); // ok flag
         WireCodec.writeU16(out, 1);                                // write ok=1
-        return out.array();                                        // bytes
+    }
+
+    // onStats: req payload = empty; resp = LatencyStats payload (uptime, per-opcode phase percentiles, counters)
+    private void onStats(WireCodec.Header reqHdr, ByteBuffer out, RequestTimer timer) {
+        timer.decoded();
+        int start = WireCodec.beginMessage(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags); // header
+        stats.write(out);                                          // snapshot straight into the reply
+        timer.computed();
+        WireCodec.endMessage(out, start);                          // patch payload length
+    }
+
+    // Batch reply bytes per item skipped without running (item header + code + message), kept free
+    // for every later item so a full reply can always still list them
+    private static final String BATCH_FULL = "batch reply full";  // for people; clients test ERR_BATCH_FULL
+    private static final int BATCH_SKIP_BYTES = 6 + 2 + 2 + BATCH_FULL.length();
+    private static final int MAX_ERROR_CHARS = 200;                // longer error messages are cut
+    private static final int ERROR_REPLY_BOUND = 2 + 2 + 3 * MAX_ERROR_CHARS; // code + UTF-8 message
+
+    // Largest reply payload a sub-request of this op can produce (FIND_ROOMS truncates to the room
+    // it is given instead); an item only runs when this much room is left, so no result that has
+    // been executed is ever discarded.
+    private int replyBound(int op) {
+        int ok;
+        switch (op) {
+            case Protocol.OP_QUERY_AVAIL: ok = 2 + 720 * 6; break;                        // alternate free minutes
+            case Protocol.OP_QUERY_WEEK:
+            case Protocol.OP_FIND_FREE: ok = 2 + OccupancyBitmap.WEEK_MINUTES / 2 * 6; break;
+            case Protocol.OP_FIND_ROOMS: ok = 3; break;                                   // count + truncated
+            case Protocol.OP_STATS: ok = stats.maxPayloadBytes(); break;
+            case Protocol.OP_BOOK: case Protocol.OP_CUSTOM_NON_IDEMPOTENT: ok = 8; break;
+            case Protocol.OP_CHANGE_BOOKING: ok = 6; break;
+            case Protocol.OP_CUSTOM_IDEMPOTENT: ok = 4; break;
+            default: ok = 2; break;                                                       // monitor, unknown
+        }
+        return Math.max(ok, ERROR_REPLY_BOUND);
+    }
+
+    // onBatch: req payload = u16 count + [u16 op + u32 len + sub-payload]*;
+    // resp = u16 count + [u16 status + u32 len + sub-result]*, status = sub-reply opCode.
+    // Items run in order and independently (a failed item does not undo earlier ones). An item only
+    // runs if the reply still has room for its largest possible result; otherwise it and every
+    // later item are skipped, unrun, with ERR_BATCH_FULL for the client to resubmit.
+    // The whole reply is cached under the batch requestId when at-most-once is requested.
+    // Each item replies into a second pooled buffer, limited to the room left; its payload is then
+    // appended to out.
+    private void onBatch(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, ChangeSet changes, RequestTimer timer) {
+        ByteBuffer item = in.duplicate();                          // view re-aimed at each sub-payload
+        int count = WireCodec.readU16(in);                         // item count
+        if (2 + count * BATCH_SKIP_BYTES > Protocol.MAX_DATAGRAM - Protocol.HEADER_LEN) {
+            error(out, reqHdr, Protocol.ERR_BAD_REQUEST, "batch too large"); // could not even list every item
+            return;
+        }
+
+        // Validate framing before running anything
+        int[] ops = new int[count];                                // sub-request ops
+        int[] offsets = new int[count];                            // sub-payload offsets
+        int[] lengths = new int[count];                            // sub-payload lengths
+        for (int i = 0; i < count; i++) {
+            if (in.remaining() < 6) { error(out, reqHdr, Protocol.ERR_BAD_REQUEST, "malformed batch"); return; }
+            ops[i] = WireCodec.readU16(in);
+            long len = WireCodec.readU32(in);
+            if (len > in.remaining()) { error(out, reqHdr, Protocol.ERR_BAD_REQUEST, "malformed batch"); return; }
+            offsets[i] = in.position(); lengths[i] = (int) len;
+            in.position(in.position() + (int) len);                // skip sub-payload
+        }
+
+        timer.decoded();                                           // items decode, run and encode below
+
+        int start = WireCodec.beginMessage(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags); // header
+        int limit = start + Protocol.MAX_DATAGRAM;                 // reply must fit one datagram
+        WireCodec.writeU16(out, count);                            // item count
+        ByteBuffer sub = WireCodec.acquireMessageBuffer();         // one item reply at a time
+        WireCodec.Header subHdr = new WireCodec.Header();          // per-item header
+        boolean full = false;                                      // an item was skipped: skip the rest
+        try {
+            for (int i = 0; i < count; i++) {
+                subHdr.version = reqHdr.version; subHdr.opCode = ops[i]; subHdr.requestId = reqHdr.requestId; subHdr.flags = reqHdr.flags; subHdr.payloadLen = lengths[i];
+                sub.clear();
+                int room = limit - out.position() - 6 - (count - i - 1) * BATCH_SKIP_BYTES; // payload bytes for this item
+                if (full || room < replyBound(ops[i])) {
+                    full = true;                                   // not run; client resubmits it and the rest
+                    error(sub, subHdr, Protocol.ERR_BATCH_FULL, BATCH_FULL);
+                } else if (ops[i] == Protocol.OP_BATCH) {
+                    error(sub, subHdr, Protocol.ERR_BAD_REQUEST, "nested batch");
+                } else {
+                    item.clear().position(offsets[i]).limit(offsets[i] + lengths[i]); // no copy
+                    sub.limit(Protocol.HEADER_LEN + room);             // FIND_ROOMS truncates to this
+                    dispatch(addr, port, subHdr, item, sub, changes, RequestTimer.OFF); // run item (timed as a whole)
+                }
+                sub.flip();
+                int status = Short.toUnsignedInt(sub.getShort(2));    // reply opCode from its header
+                WireCodec.writeU16(out, status);                       // sub-reply status
+                WireCodec.writeU32(out, sub.limit() - Protocol.HEADER_LEN); // sub-payload length
+                sub.position(Protocol.HEADER_LEN);
+                out.put(sub);                                          // sub-payload bytes
+            }
+        } finally {
+            WireCodec.releaseMessageBuffer(sub);
+        }
+        timer.computed();
+        timer.results(count);                                      // items answered
+        WireCodec.endMessage(out, start);                          // patch payload length
     }
 
     // Custom idempotent: reset facility schedule for a specific day. Repeated calls yield same result; idempotent.
-    private byte[] onCustomIdem(InetAddress addr, int port, WireCodec.Header reqHdr, byte[] payload) {
-        ByteBuffer in = WireCodec.wrap(payload);                   // wrap
-        String facility = WireCodec.readString(in);                // facility name
+    private void onCustomIdem(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, ChangeSet changes, RequestTimer timer) {
+        String facility = names.read(in);                          // facility name
         int dayValue = Byte.toUnsignedInt(in.get());               // read day (0-6)
         Types.Day day = Types.Day.fromValue(dayValue);             // convert to enum
-        int removedCount = logic.resetDaySchedule(facility, day);  // reset schedule (idempotent)
-        ByteBuffer out = WireCodec.newMessageBuffer(4);            // u32 for removed count
-        WireCodec.Header h = new WireCodec.Header();               // header
-        h.version = Protocol.VERSION; h.opCode = reqHdr.opCode; h.requestId = reqHdr.requestId; h.flags = reqHdr.flags; h.payloadLen = 4; // fill
-        WireCodec.writeHeader(out, h);                             // write header
+        timer.facility(facility);
+        timer.decoded();
+        int removedCount = logic.resetDaySchedule(facility, day, changes); // reset schedule (idempotent)
+        timer.computed();
+        WireCodec.writeHeader(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags, 4); // u32 for removed count
         WireCodec.writeU32(out, removedCount);                     // write count of removed bookings
-        return out.array();                                        // bytes
     }
 
     // Custom non-idempotent: increment usage counter; tracks how many times a facility has been accessed (non-idempotent)
-    private final Map<String, Long> facilityUsageCounters = new HashMap<>(); // facility -> usage counter
-    private byte[] onCustomNonIdem(InetAddress addr, int port, WireCodec.Header reqHdr, byte[] payload) {
-        ByteBuffer in = WireCodec.wrap(payload);                   // wrap
-        String facility = WireCodec.readString(in);                // facility
-        long cur = facilityUsageCounters.getOrDefault(facility, 0L); // read current usage count
-        cur += 1;                                                  // increment usage counter (non-idempotent)
-        facilityUsageCounters.put(facility, cur);                  // store updated count
-        ByteBuffer out = WireCodec.newMessageBuffer(8);            // return new value
-        WireCodec.Header h = new WireCodec.Header();               // header
-        h.version = Protocol.VERSION; h.opCode = reqHdr.opCode; h.requestId = reqHdr.requestId; h.flags = reqHdr.flags; h.payloadLen = 8; // fill
-        WireCodec.writeHeader(out, h);                             // write header
+    private void onCustomNonIdem(InetAddress addr, int port, WireCodec.Header reqHdr, ByteBuffer in, ByteBuffer out, ChangeSet changes, RequestTimer timer) {
+        String facility = names.read(in);                          // facility
+        timer.facility(facility);
+        timer.decoded();
+        long cur = logic.incrementUsage(facility, changes);        // atomic increment (non-idempotent)
+        timer.computed();
+        WireCodec.writeHeader(out, reqHdr.opCode, reqHdr.requestId, reqHdr.flags, 8); // return new value
         WireCodec.writeI64(out, cur);                              // write usage counter value
-        return out.array();                                        // bytes
     }
 }
@@ -0,0 +1,53 @@
+/*
+ * RequestTimer.java
+ * Purpose: Phase timestamps of the request a worker is handling: decode, logic, encode (send is
+ *          timed by the worker itself), plus the facility and result count handlers report.
+ *          Feeds LatencyStats and the ServerEvents.Request flight-recorder event.
+ * Design notes:
+ * - One per worker, reused for every request, like ChangeSet. Handlers mark the end of decoding
+ *   and of the logic; the router marks the end of encoding.
+ * - OFF is a shared instance whose marks do nothing, used when latency stats are disabled and no
+ *   flight recording wants request events, so the hot path then pays one predictable branch per
+ *   mark and no System.nanoTime() call.
+ * - Phases a request skips (an at-most-once hit, an early error) count as zero; their time goes
+ *   to the next phase that is marked.
+ */
+
+public final class RequestTimer {
+    public static final RequestTimer OFF = new RequestTimer(false); // disabled: marks are no-ops
+
+    private final boolean on;                 // take timestamps
+    private long start;                       // request received
+    private long decoded;                     // request fields read (0: not marked)
+    private long computed;                    // logic done (0: not marked)
+    private long encoded;                     // reply encoded
+    private String facility;                  // facility named by the request (null: none)
+    private int results;                      // intervals or names the reply carries
+
+    public RequestTimer() { this(true); }
+
+    private RequestTimer(boolean on) { this.on = on; }
+
+    public boolean on() { return on; }
+
+    public void start() { if (on) { start = System.nanoTime(); decoded = 0; computed = 0; facility = null; results = 0; } }
+    public void decoded() { if (on) decoded = System.nanoTime(); }
+    public void computed() { if (on) computed = System.nanoTime(); }
+    public void facility(String name) { if (on) facility = name; }
+    public void results(int n) { if (on) results = n; }
+
+    // Reply is complete; fills in phases that were skipped
+    public void encoded() {
+        if (!on) return;
+        encoded = System.nanoTime();
+        if (decoded == 0) decoded = start;
+        if (computed == 0) computed = decoded;
+    }
+
+    public String facility() { return facility; }
+    public int results() { return results; }
+    public long encodedAt() { return encoded; }
+    public long decodeNanos() { return decoded - start; }
+    public long logicNanos() { return computed - decoded; }
+    public long encodeNanos() { return encoded - computed; }
+}
@@ -3,139 +3,217 @@
  * Purpose: Implements business rules for booking, querying availability, and changing bookings.
  * Design notes:
  * - Booking allowed only if new interval does not overlap existing bookings for same facility.
+ *   Conflicts are a word-wise test on the facility's OccupancyBitmap, independent of booking count.
  * - Change booking applies offset minutes and validates no overlap; otherwise returns conflict.
+ * - Check-then-act sequences hold the facility's write lock; queries hold its read lock.
+ * - Free-slot search asks the bitmap's free-run tree, kept current by every set/clear.
+ * - Mutators record the days they changed into an optional ChangeSet for monitor callbacks.
+ * - With a WriteAheadLog, each mutation appends an absolute WalRecord while still holding the
+ *   facility write lock (so per-facility log order is apply order) and reports its LSN in the
+ *   ChangeSet; the reply is held until that LSN is durable.
+ * - Facility locks are taken through lockRead/lockWrite: a try first, and only if that fails a
+ *   blocking wait recorded as a ServerEvents.FacilityLockWait flight-recorder event.
  */
 
 import java.util.List;
 import java.util.ArrayList;
-import java.util.Comparator;
 
 public class ReservationLogic {
     private final FacilityStore store; // storage dependency
+    private final WriteAheadLog wal;   // mutation log, or null for memory only
 
     public ReservationLogic(FacilityStore store) {
+        this(store, null);              // no durability
+    }
+
+    public ReservationLogic(FacilityStore store, WriteAheadLog wal) {
         this.store = store; // assign store
+        this.wal = wal;     // assign log
     }
 
-    // Check if weekly time intervals overlap (using week minutes for comparison)
-    private boolean hasOverlap(List<Types.Booking> bookings, Types.WeeklyTime start, Types.WeeklyTime end, Long excludeId) {
-        int startMinutes = start.toWeekMinutes();                       // convert to week minutes
-        int endMinutes = end.toWeekMinutes();                           // convert to week minutes
-        
-        for (Types.Booking b : bookings) {                              // iterate existing bookings
-            if (excludeId != null && b.id == excludeId) continue;       // skip the booking being changed
-            int bStart = b.start.toWeekMinutes();                       // booking start in week minutes
-            int bEnd = b.end.toWeekMinutes();                           // booking end in week minutes
-            if (Math.max(bStart, startMinutes) < Math.min(bEnd, endMinutes)) {
-                return true;                                            // intervals overlap
-            }
-        }
-        return false;                                                   // no overlap found
+    // Append a record (under the facility lock) and report its LSN with the request's changes
+    private void log(byte[] record, ChangeSet changes) {
+        if (wal == null) return;
+        long lsn = wal.append(record);
+        if (changes != null) changes.setLsn(lsn);
     }
 
-    // Book a new interval; returns booking id or throws ConflictException
-    public long book(String facility, String user, Types.WeeklyTime start, Types.WeeklyTime end) throws ConflictException {
-        store.ensureFacility(facility);                                 // ensure facility exists
-        List<Types.Booking> existing = store.getFacilityBookings(facility); // snapshot existing
-        if (hasOverlap(existing, start, end, null)) {                   // detect overlap
-            throw new ConflictException("overlap");                    // conflict error
+    // Take the facility's write lock, recording the wait if it was contended
+    private static void lockWrite(Types.Facility f) {
+        if (f.lock.writeLock().tryLock()) return;                       // uncontended: no event
+        ServerEvents.FacilityLockWait event = new ServerEvents.FacilityLockWait();
+        event.begin();
+        f.lock.writeLock().lock();
+        if (event.shouldCommit()) { event.facility = f.name; event.write = true; event.commit(); }
+    }
+
+    // Take the facility's read lock, recording the wait if it was contended
+    private static void lockRead(Types.Facility f) {
+        if (f.lock.readLock().tryLock()) return;                        // uncontended: no event
+        ServerEvents.FacilityLockWait event = new ServerEvents.FacilityLockWait();
+        event.begin();
+        f.lock.readLock().lock();
+        if (event.shouldCommit()) { event.facility = f.name; event.commit(); }
+    }
+
+    // Check if weekly time intervals overlap any booked minute of the facility
+    private boolean hasOverlap(Types.Facility f, int startMinutes, int endMinutes) {
+        return f.occupancy.anySet(startMinutes, endMinutes);            // word-wise AND over the range
+    }
+
+    // Book week minutes [start, end); returns booking id or throws ConflictException
+    public long book(String facility, String user, int start, int end, ChangeSet changes) throws ConflictException {
+        if (end <= start) {
+            throw new ConflictException("end must be after start");    // empty/negative interval
+        }
+        Types.Facility f = store.ensureFacility(facility);              // ensure facility exists
+        lockWrite(f);                                                   // check+add must be atomic per facility
+        try {
+            if (hasOverlap(f, start, end)) {                            // detect overlap
+                throw new ConflictException("overlap");                // conflict error
+            }
+            long id = store.newBookingId();                             // generate new id
+            Types.Booking b = new Types.Booking(id, facility, user, start, end); // create booking
+            store.addBooking(b);                                        // persist booking
+            log(WalRecord.book(id, facility, user, start, end), changes);
+            if (changes != null) changes.addRange(facility, start, end);
+            return id;                                                  // return id
+        } finally {
+            f.lock.writeLock().unlock();
         }
-        long id = store.newBookingId();                                 // generate new id
-        Types.Booking b = new Types.Booking(id, facility, user, start, end); // create booking
-        store.addBooking(b);                                            // persist booking
-        return id;                                                      // return id
     }
 
     // Change booking by offset minutes; returns updated interval; may throw not found or conflict
-    public Types.Interval change(long bookingId, int offsetMinutes) throws NotFoundException, ConflictException {
+    public Types.Interval change(long bookingId, int offsetMinutes, ChangeSet changes) throws NotFoundException, ConflictException {
         Types.Booking b = store.getBooking(bookingId);                  // lookup booking
         if (b == null) throw new NotFoundException("booking");         // not found
-        
-        // Calculate duration in minutes
-        int startMinutes = b.start.toWeekMinutes();                     // current start in week minutes
-        int endMinutes = b.end.toWeekMinutes();                         // current end in week minutes
-        int duration = endMinutes - startMinutes;                       // duration in minutes
-        
-        // Apply offset
-        int newStartMinutes = startMinutes + offsetMinutes;             // new start with offset
-        int newEndMinutes = newStartMinutes + duration;                 // preserve duration
-        
-        // Validate within week bounds (0 to 7*24*60-1 minutes)
-        if (newStartMinutes < 0 || newEndMinutes >= 7 * 24 * 60) {
-            throw new ConflictException("time out of week bounds");     // out of bounds
-        }
-        
-        Types.WeeklyTime newStart = Types.WeeklyTime.fromWeekMinutes(newStartMinutes);
-        Types.WeeklyTime newEnd = Types.WeeklyTime.fromWeekMinutes(newEndMinutes);
-        
-        List<Types.Booking> existing = store.getFacilityBookings(b.facility); // get peers
-        if (hasOverlap(existing, newStart, newEnd, b.id)) {             // check conflicts
-            throw new ConflictException("overlap");                    // conflict
+        Types.Facility f = store.ensureFacility(b.facility);            // owning facility
+        lockWrite(f);
+        try {
+            if (store.getBooking(bookingId) != b) throw new NotFoundException("booking"); // removed meanwhile
+
+            // Calculate duration in minutes
+            int startMinutes = b.start;                                 // current start in week minutes
+            int endMinutes = b.end;                                     // current end in week minutes
+            int duration = endMinutes - startMinutes;                   // duration in minutes
+
+            // Apply offset
+            int newStartMinutes = startMinutes + offsetMinutes;         // new start with offset
+            int newEndMinutes = newStartMinutes + duration;             // preserve duration
+
+            // Validate within week bounds (0 to 7*24*60-1 minutes)
+            if (newStartMinutes < 0 || newEndMinutes >= 7 * 24 * 60) {
+                throw new ConflictException("time out of week bounds"); // out of bounds
+            }
+
+            f.occupancy.clear(startMinutes, endMinutes);                // exclude the booking being moved
+            boolean conflict = hasOverlap(f, newStartMinutes, newEndMinutes); // check conflicts
+            f.occupancy.set(startMinutes, endMinutes);                  // restore; moveBooking clears it
+            if (conflict) throw new ConflictException("overlap");       // conflict
+            store.moveBooking(b, newStartMinutes, newEndMinutes);       // re-index, update bitmap and versions
+            log(WalRecord.change(bookingId, newStartMinutes, newEndMinutes), changes);
+            if (changes != null) {
+                changes.addRange(f.name, startMinutes, endMinutes);     // days the booking left
+                changes.addRange(f.name, newStartMinutes, newEndMinutes); // days it moved into
+            }
+            return new Types.Interval(newStartMinutes, newEndMinutes);  // return new interval
+        } finally {
+            f.lock.writeLock().unlock();
         }
-        b.start = newStart;                                             // apply update
-        b.end = newEnd;                                                 // apply update
-        return new Types.Interval(newStart, newEnd);                    // return new interval
     }
 
-    // Helper: get facility name for a booking id; returns null if not found
-    public String getBookingFacility(long bookingId) {
-        Types.Booking b = store.getBooking(bookingId);                  // lookup booking
-        return b == null ? null : b.facility;                           // return facility or null
+    // Helper: get facility or null
+    public Types.Facility getFacility(String facility) {
+        return store.getFacility(facility);                             // delegate to store
     }
 
-    // Helper: get all bookings for a facility
-    public List<Types.Booking> getFacilityBookings(String facility) {
-        return store.getFacilityBookings(facility);                     // delegate to store
+    // Query available non-booked intervals for a specific day of the week. Every booked minute of the
+    // day counts, including the tail of a booking that started the previous day and ran past midnight.
+    public List<Types.Interval> queryDay(String facility, Types.Day day) {
+        int dayStart = day.value * 24 * 60;                             // first minute of the day
+        return queryRange(facility, dayStart, dayStart + 23 * 60 + 59); // 23:59 closes the reported day
     }
 
-    // Query available non-booked intervals for a specific day of the week
-    public List<Types.Interval> queryDay(String facility, Types.Day day) {
-        List<Types.Booking> existing = store.getFacilityBookings(facility); // fetch bookings
-        
-        // Filter bookings for the requested day
-        List<Types.Booking> dayBookings = new ArrayList<>();
-        for (Types.Booking b : existing) {
-            if (b.start.day == day) {                                   // booking is on requested day
-                dayBookings.add(b);
+    // Query free intervals in week minutes [from, to), split at day boundaries. Each day is reported
+    // up to 23:59 like queryDay, so the whole week equals the seven day queries concatenated.
+    // One read lock and one forward pass over the occupancy bitmap, whatever the range.
+    public List<Types.Interval> queryRange(String facility, int from, int to) {
+        List<Types.Interval> result = new ArrayList<>();                // result intervals
+        Types.Facility f = store.getFacility(facility);                 // lookup facility (null: all free)
+        if (f != null) lockRead(f);                                     // shared with other readers
+        try {
+            for (int dayStart = from - from % (24 * 60); dayStart < to; dayStart += 24 * 60) {
+                int pos = Math.max(from, dayStart);                     // clip to the range
+                int dayLimit = Math.min(to, dayStart + 23 * 60 + 59);   // and to 23:59 of this day
+                // Walk runs of free minutes in the occupancy bitmap
+                while (pos < dayLimit) {
+                    int freeStart = f == null ? pos : f.occupancy.nextClear(pos, dayLimit);       // first free minute
+                    if (freeStart >= dayLimit) break;                   // rest of day booked
+                    int freeEnd = f == null ? dayLimit : f.occupancy.nextSet(freeStart, dayLimit); // first booked minute after it
+                    result.add(new Types.Interval(freeStart, freeEnd)); // free gap
+                    pos = freeEnd;
+                }
             }
+        } finally {
+            if (f != null) f.lock.readLock().unlock();
         }
-        
-        // Sort by start time within the day
-        dayBookings.sort(Comparator.comparingInt(x -> x.start.toWeekMinutes()));
-        
+
+        return result;                                                  // return free intervals
+    }
+
+    // First maxResults free runs of at least minMinutes inside week minutes [from, to), in time order.
+    // Each run is found in O(log n) through the occupancy bitmap's free-run tree; runs may cross
+    // midnight and never end after Sunday 23:59.
+    public List<Types.Interval> findFree(String facility, int from, int to, int minMinutes, int maxResults) {
         List<Types.Interval> result = new ArrayList<>();                // result intervals
-        Types.WeeklyTime cursor = new Types.WeeklyTime(day, 0, 0);      // start at 00:00 of requested day
-        Types.WeeklyTime dayEnd = new Types.WeeklyTime(day, 23, 59);    // end at 23:59 of requested day
-        
-        // If no bookings, return the entire day as available
-        if (dayBookings.isEmpty()) {
-            result.add(new Types.Interval(cursor, dayEnd));
+        to = Math.min(to, FreeRunTree.LIMIT);                           // last expressible end
+        Types.Facility f = store.getFacility(facility);                 // lookup facility
+        if (f == null) {                                                // unknown facility: all free
+            if (to - from >= minMinutes) result.add(new Types.Interval(from, to));
             return result;
         }
-        
-        for (Types.Booking b : dayBookings) {                           // iterate day bookings
-            // Check if there's a gap before this booking
-            if (b.start.toWeekMinutes() > cursor.toWeekMinutes()) {
-                result.add(new Types.Interval(cursor, b.start));        // add free gap
+        lockRead(f);                                                    // shared with other readers
+        try {
+            int pos = from;
+            while (result.size() < maxResults) {
+                int start = f.occupancy.firstFree(pos, to, minMinutes); // first long-enough run
+                if (start < 0) break;                                   // none left in the window
+                int end = f.occupancy.nextSet(start + minMinutes, to);  // extend to the end of the run
+                result.add(new Types.Interval(start, end));
+                pos = end;
             }
-            // Move cursor to end of this booking
-            cursor = b.end;
-            if (cursor.toWeekMinutes() >= dayEnd.toWeekMinutes()) break; // reached end of day
-        }
-        
-        // Add remaining time if any
-        if (cursor.toWeekMinutes() < dayEnd.toWeekMinutes()) {
-            result.add(new Types.Interval(cursor, dayEnd));             // add remaining free time
+        } finally {
+            f.lock.readLock().unlock();
         }
-        
-        return result;                                                  // return free intervals
+        return result;
+    }
+
+    // Names of facilities with nothing booked in week minutes [from, to), at most max of them
+    public List<String> findRooms(int from, int to, int max) {
+        return store.columns().freeDuring(from, to, max);               // columnar scan, no per-facility walk
     }
 
     // Reset facility schedule for a specific day (idempotent operation)
     // Removes all bookings for the specified day
     // Returns count of removed bookings (0 if already empty or repeated call)
-    public int resetDaySchedule(String facility, Types.Day day) {
-        return store.removeBookingsForDay(facility, day);               // delegate to store
+    public int resetDaySchedule(String facility, Types.Day day, ChangeSet changes) {
+        Types.Facility f = store.getFacility(facility);                 // lookup facility
+        if (f == null) return 0;                                        // nothing to remove
+        lockWrite(f);                                                   // remove + log in one critical section
+        try {
+            int removed = store.removeBookingsForDay(facility, day, changes); // delegate to store
+            if (removed > 0) log(WalRecord.reset(facility, day), changes); // no-op resets need no record
+            return removed;
+        } finally {
+            f.lock.writeLock().unlock();
+        }
+    }
+
+    // Increment the facility's usage counter (non-idempotent); returns the new value
+    public long incrementUsage(String facility, ChangeSet changes) {
+        long value = store.incrementUsage(facility);                    // atomic increment
+        log(WalRecord.incr(facility, value), changes);                  // absolute value: replay takes the max
+        return value;
     }
 
     // Exception types to map to protocol errors
@@ -0,0 +1,76 @@
+/*
+ * ServerEvents.java
+ * Purpose: Java Flight Recorder event types emitted by the server, so a continuous recording
+ *          (-XX:StartFlightRecording) can explain tail latency offline next to JFR's own GC,
+ *          safepoint and lock events.
+ * Design notes:
+ * - Request: one per handled request (op, facility, status, results produced), spanning
+ *   receive to send; a reply held for the write-ahead log ends the event when it is handed off.
+ * - FacilityLockWait: only when a facility read/write lock was not free at once, with the
+ *   time spent waiting. Uncontended acquisitions emit nothing.
+ * - CallbackBatch: one per (facility, day) key a fan-out sender handled.
+ * - CacheSweep: one per at-most-once expiry pass and per monitor lease sweep.
+ * - Callers create the event, check isEnabled() and only then fill it in, so with no recording
+ *   the JIT removes the event object and the hot path pays nothing. Stack traces are off.
+ */
+
+import jdk.jfr.Category;
+import jdk.jfr.DataAmount;
+import jdk.jfr.Description;
+import jdk.jfr.Event;
+import jdk.jfr.Label;
+import jdk.jfr.Name;
+import jdk.jfr.StackTrace;
+import jdk.jfr.Timespan;
+
+public final class ServerEvents {
+    @Name("sc6103.Request")
+    @Label("Request")
+    @Category("Facility Booking")
+    @Description("One request, from receive to reply sent (or handed to the write-ahead log)")
+    @StackTrace(false)
+    public static final class Request extends Event {
+        @Label("Op") public int op;                                    // request opCode
+        @Label("Request Id") public long requestId;
+        @Label("Status") public int status;                            // reply opCode (error bit on failure)
+        @Label("Facility") public String facility;                     // null for ops without one
+        @Label("Results") public int results;                          // intervals or names produced
+        @Label("Reply Size") @DataAmount public int replyBytes;
+        @Label("Deferred") public boolean deferred;                    // reply waits for the log
+    }
+
+    @Name("sc6103.FacilityLockWait")
+    @Label("Facility Lock Wait")
+    @Category("Facility Booking")
+    @Description("Time a request waited for a contended facility lock")
+    @StackTrace(false)
+    public static final class FacilityLockWait extends Event {
+        @Label("Facility") public String facility;
+        @Label("Exclusive") public boolean write;                      // write lock (else read)
+    }
+
+    @Name("sc6103.CallbackBatch")
+    @Label("Callback Batch")
+    @Category("Facility Booking")
+    @Description("Monitor callbacks sent for one facility day")
+    @StackTrace(false)
+    public static final class CallbackBatch extends Event {
+        @Label("Facility") public String facility;
+        @Label("Day") public int day;                                  // 0 = Monday
+        @Label("Datagrams") public int datagrams;                      // callbacks sent
+        @Label("Queue Delay") @Timespan public long queueDelay;        // submit to dequeue, ns
+    }
+
+    @Name("sc6103.CacheSweep")
+    @Label("Cache Sweep")
+    @Category("Facility Booking")
+    @Description("One expiry pass over a server cache")
+    @StackTrace(false)
+    public static final class CacheSweep extends Event {
+        @Label("Cache") public String cache;                           // "amoCache" or "monitors"
+        @Label("Removed") public int removed;                          // entries dropped this pass
+        @Label("Remaining") public int remaining;                      // entries left
+    }
+
+    private ServerEvents() { /* holder */ }
+}
@@ -1,16 +1,32 @@
 /*
  * ServerMain.java
- * Purpose: UDP server main loop. Receives requests, routes them, sends responses, and
- *          sends monitor callbacks on booking/changes. Supports at-most-once cache sweep
- *          and monitor sweep. Also supports simulated packet loss of responses.
+ * Purpose: UDP server entry point. Parses options, wires up the components and starts
+ *          the receive workers (see ServerWorker) that route requests, send responses and
+ *          monitor callbacks. Supports at-most-once cache sweep, monitor sweep and
+ *          simulated packet loss of responses.
+ * Design notes:
+ * - --workers N starts N receive threads. Where the OS supports SO_REUSEPORT each worker
+ *   binds its own DatagramChannel to the same address and the kernel load-balances
+ *   datagrams across them; otherwise all workers share one channel.
+ * - Monitor callbacks are sent by CallbackFanout sender threads (--fanoutThreads, --fanoutQueue).
+ * - Mutations go to a write-ahead log in --walDir (group commit: --walWindowUs, --walBatchBytes)
+ *   and are replayed from it on startup; --durable false keeps everything in memory only.
+ * - With the log on, a snapshot of the store is written to --snapshotDir every
+ *   --snapshotIntervalSec. Startup maps the newest snapshot and replays only the log after it;
+ *   log segments (--walSegmentBytes each) that a kept snapshot covers are deleted.
+ * - --latencyStats keeps per-opcode histograms of decode/logic/encode/send time; OP_STATS returns
+ *   their percentiles with cache, fan-out and log counters.
+ * - --logRequests puts a binary record per request (1 in --logSample) into RequestLog's ring;
+ *   a background thread prints them, or appends them raw to --logFile. A full ring
+ *   (--logRingSize) drops new records and counts them.
  */
 
+import java.io.IOException;
 import java.net.*;
-import java.nio.*;
-import java.time.*;
-import java.util.Random;
-import java.util.Arrays;
+import java.nio.channels.DatagramChannel;
+import java.nio.file.Paths;
 import java.util.List;
+import java.util.ArrayList;
 
 public class ServerMain {
     public static void main(String[] args) throws Exception {
@@ -19,6 +35,22 @@ public class ServerMain {
         int port = 9999;                          // listen port
         boolean atMostOnce = true;                // enable at-most-once cache
         double lossSim = 0.0;                     // probability to drop outbound responses
+        int workers = 1;                          // number of receive threads
+        boolean logRequests = true;               // log one record per request
+        int logSample = 1;                        // log 1 in N requests
+        int logRingSize = RequestLog.DEFAULT_CAPACITY; // records buffered for the log thread
+        String logFile = null;                    // binary request log (null: text to stdout)
+        boolean latencyStats = true;              // per-opcode phase histograms for OP_STATS
+        int fanoutThreads = 2;                    // callback sender threads
+        int fanoutQueue = 4096;                   // max (facility, day) callbacks waiting
+        int amoMaxEntries = RequestRouter.DEFAULT_AMO_MAX_ENTRIES; // at-most-once cache bound
+        boolean durable = true;                   // log mutations before replying
+        String walDir = "data/wal";               // write-ahead log directory
+        long walWindowUs = WriteAheadLog.DEFAULT_WINDOW_US;       // group-commit window
+        int walBatchBytes = WriteAheadLog.DEFAULT_BATCH_BYTES;    // flush early at this size
+        long walSegmentBytes = WriteAheadLog.DEFAULT_SEGMENT_BYTES; // roll to a new segment at this size
+        String snapshotDir = "data/snapshot";    // snapshot directory
+        int snapshotIntervalSec = 60;             // seconds between snapshots (0 = never)
 
         // Parse simple CLI arguments
         for (int i = 0; i < args.length; i++) {
@@ -27,112 +59,116 @@ public class ServerMain {
                 case "--port": port = Integer.parseInt(args[++i]); break; // read port value
                 case "--atMostOnce": atMostOnce = Boolean.parseBoolean(args[++i]); break; // read flag
                 case "--lossSim": lossSim = Double.parseDouble(args[++i]); break; // loss simulation probability
+                case "--workers": workers = Math.max(1, Integer.parseInt(args[++i])); break; // receive threads
+                case "--logRequests": logRequests = Boolean.parseBoolean(args[++i]); break; // per-request log
+                case "--logSample": logSample = Math.max(1, Integer.parseInt(args[++i])); break; // sampling
+                case "--logRingSize": logRingSize = Math.max(2, Integer.parseInt(args[++i])); break; // ring bound
+                case "--logFile": logFile = args[++i]; break;                              // binary log file
+                case "--latencyStats": latencyStats = Boolean.parseBoolean(args[++i]); break; // phase histograms
+                case "--fanoutThreads": fanoutThreads = Math.max(1, Integer.parseInt(args[++i])); break; // senders
+                case "--fanoutQueue": fanoutQueue = Math.max(1, Integer.parseInt(args[++i])); break; // queue bound
+                case "--amoMaxEntries": amoMaxEntries = Math.max(1, Integer.parseInt(args[++i])); break; // cache bound
+                case "--durable": durable = Boolean.parseBoolean(args[++i]); break;        // write-ahead log on/off
+                case "--walDir": walDir = args[++i]; break;                                // log directory
+                case "--walWindowUs": walWindowUs = Long.parseLong(args[++i]); break;      // group-commit window
+                case "--walBatchBytes": walBatchBytes = Integer.parseInt(args[++i]); break; // early flush size
+                case "--walSegmentBytes": walSegmentBytes = Long.parseLong(args[++i]); break; // segment size
+                case "--snapshotDir": snapshotDir = args[++i]; break;                      // snapshot directory
+                case "--snapshotIntervalSec": snapshotIntervalSec = Math.max(0, Integer.parseInt(args[++i])); break; // period
             }
         }
 
         // Initialize components
         FacilityStore store = new FacilityStore();                         // in-memory storage
-        ReservationLogic logic = new ReservationLogic(store);              // business logic
+        WriteAheadLog wal = null;                                          // mutation log
+        if (durable) {
+            wal = new WriteAheadLog(Paths.get(walDir), walWindowUs, walBatchBytes, walSegmentBytes);
+            Snapshot snapshot = new Snapshot(Paths.get(snapshotDir), store, wal);
+            long t0 = System.nanoTime();
+            Snapshot.Loaded image = snapshot.load();                       // mapped snapshot, if any
+            long t1 = System.nanoTime();
+            long lsn = wal.recover(image.lsn, (seq, body) -> {             // then the log written after it
+                if (!image.covers(seq, body, store)) WalRecord.apply(body, store);
+            });
+            System.out.printf("Recovered snapshot lsn=%d (%d bookings) in %.1f ms, %s up to lsn=%d in %.1f ms%n",
+                    image.lsn, image.bookings, (t1 - t0) / 1e6, walDir, lsn, (System.nanoTime() - t1) / 1e6);
+            wal.start();                                                   // new segment + writer thread
+            if (snapshotIntervalSec > 0) snapshot.start(snapshotIntervalSec * 1000L); // background snapshots
+        }
+        ReservationLogic logic = new ReservationLogic(store, wal);         // business logic
         MonitorRegistry monitors = new MonitorRegistry();                  // monitor registry
-        RequestRouter router = new RequestRouter(logic, monitors, 60_000); // cache TTL 60s
-        Random rnd = new Random();                                         // RNG for loss sim
-
-        DatagramSocket sock = new DatagramSocket(new InetSocketAddress(host, port)); // bind UDP socket
-        sock.setSoTimeout(500);                                            // timeout for periodic sweeps
-
-        System.out.println("Server listening on " + host + ":" + port + " atMostOnce=" + atMostOnce + " lossSim=" + lossSim);
+        LatencyStats stats = new LatencyStats(latencyStats);               // served by OP_STATS
+        RequestRouter router = new RequestRouter(logic, monitors, 60_000, amoMaxEntries, stats); // cache TTL 60s
+        router.amoCache().start();                                         // cache expiry thread
+        monitors.start();                                                  // monitor lease sweeps
 
-        byte[] buf = new byte[64 * 1024];                                 // receive buffer (max UDP payload)
-        long lastSweep = System.currentTimeMillis();                       // last sweep time
+        List<DatagramChannel> channels = bindChannels(new InetSocketAddress(host, port), workers); // bind UDP sockets
 
-        // Main loop
-        while (true) {
-            try {
-                DatagramPacket pkt = new DatagramPacket(buf, buf.length); // prepare packet holder
-                sock.receive(pkt);                                        // blocking receive with timeout
+        System.out.println("Server listening on " + host + ":" + port + " atMostOnce=" + atMostOnce + " lossSim=" + lossSim
+                + " workers=" + workers + " sockets=" + channels.size());
 
-                // Copy the exact datagram bytes (pkt.getLength()) to a new array
-                byte[] reqBytes = Arrays.copyOfRange(pkt.getData(), 0, pkt.getLength()); // request bytes slice
+        CallbackFanout fanout = new CallbackFanout(router, monitors, channels.get(0).socket(), lossSim, fanoutQueue);
+        fanout.start(fanoutThreads);                                       // callback sender threads
 
-                // Parse header just for logging and flags; router will parse again (kept simple)
-                WireCodec.Header hdr = WireCodec.readHeader(WireCodec.wrap(reqBytes)); // read header for log
-                long t0 = System.currentTimeMillis();                      // start timing
+        RequestLog log = null;                                             // asynchronous request log
+        if (logRequests) {
+            log = new RequestLog(logRingSize, logSample, logFile == null ? null : Paths.get(logFile));
+            log.start();                                                   // formatter thread
+        }
 
-                // Handle request and construct response
-                byte[] resp = router.handle(pkt.getAddress(), pkt.getPort(), reqBytes, (hdr.flags & Protocol.FLAG_AT_MOST_ONCE) != 0); // route
-                long elapsed = System.currentTimeMillis() - t0;            // elapsed time
+        // Counters reported by OP_STATS alongside the latency percentiles
+        stats.counter("availCache.hits", router.availability()::hits);
+        stats.counter("availCache.misses", router.availability()::misses);
+        stats.counter("amoCache.size", router.amoCache()::size);
+        stats.counter("amoCache.hits", router.amoCache()::hits);
+        stats.counter("amoCache.inFlightDrops", router.amoCache()::inFlightDrops);
+        stats.counter("fanout.queueDepth", fanout::queueDepth);
+        stats.counter("fanout.datagramsSent", fanout::datagramsSent);
+        stats.counter("fanout.dropped", fanout::dropped);
+        stats.counter("fanout.avgLatencyNs", fanout::avgLatencyNs);
+        stats.counter("monitors", monitors::size);
+        stats.counter("worker.malformed", ServerWorker::malformedRequests);
+        stats.counter("worker.ioErrors", ServerWorker::ioErrors);
+        if (wal != null) {
+            stats.counter("wal.records", wal::records);
+            stats.counter("wal.commits", wal::commits);
+        }
+        if (log != null) stats.counter("requestLog.dropped", log::dropped);
 
-                // Log request
-                System.out.println("req id=" + hdr.requestId + " op=0x" + Integer.toHexString(hdr.opCode) + " elapsedMs=" + elapsed);
+        Thread[] threads = startWorkers(channels, workers, router, fanout, wal, lossSim, log);
+        for (Thread t : threads) t.join();                                 // run until the process is killed
+    }
 
-                // Simulate loss if configured
-                if (rnd.nextDouble() < lossSim) {
-                    System.out.println("[LOSS] Dropping response for req=" + hdr.requestId); // drop response
-                } else {
-                    // Send response
-                    DatagramPacket rp = new DatagramPacket(resp, resp.length, pkt.getAddress(), pkt.getPort()); // build packet
-                    sock.send(rp);                                        // sendto
-                }
+    // Bind one channel per worker with SO_REUSEPORT, or a single shared channel if unsupported
+    public static List<DatagramChannel> bindChannels(InetSocketAddress addr, int workers) throws IOException {
+        List<DatagramChannel> channels = new ArrayList<>();
+        DatagramChannel first = DatagramChannel.open();                                // first socket
+        boolean reusePort = workers > 1 && first.supportedOptions().contains(StandardSocketOptions.SO_REUSEPORT);
+        if (reusePort) first.setOption(StandardSocketOptions.SO_REUSEPORT, true);     // must be set before bind
+        first.bind(addr);                                                              // bind listen address
+        channels.add(first);
+        if (!reusePort) return channels;                                               // workers share one socket
 
-                // On booking or change, notify monitors via callback with QUERY_AVAIL result
-                if (hdr.opCode == Protocol.OP_BOOK || hdr.opCode == Protocol.OP_CHANGE_BOOKING) {
-                    try {
-                        // Extract facility depending on opcode
-                        String facility = null;                                                      // facility holder
-                        ByteBuffer in = WireCodec.wrap(Arrays.copyOfRange(reqBytes, Protocol.HEADER_LEN, reqBytes.length)); // payload only
-                        if (hdr.opCode == Protocol.OP_BOOK) {
-                            facility = WireCodec.readString(in);                                    // BOOK carries facility string first
-                        } else if (hdr.opCode == Protocol.OP_CHANGE_BOOKING) {
-                            long bookingId = WireCodec.readI64(in);                                  // CHANGE carries bookingId first
-                            facility = logic.getBookingFacility(bookingId);                          // lookup facility from store
-                        }
-                        if (facility != null) {
-                            // For weekly schedule, send callback for all days that have bookings
-                            // Find all days with bookings for this facility
-                            java.util.Set<Types.Day> affectedDays = new java.util.HashSet<>();
-                            List<Types.Booking> facilityBookings = logic.getFacilityBookings(facility);
-                            for (Types.Booking booking : facilityBookings) {
-                                affectedDays.add(booking.start.day);
-                            }
-                            
-                            // Send callback for each affected day
-                            for (Types.Day day : affectedDays) {
-                                List<Types.Interval> ivals = logic.queryDay(facility, day);     // compute intervals for this day
-                                int count = ivals.size();
-                                int payloadLen = 2 + 1 + count * 6;                             // u16 + day + N*(WeeklyTime,WeeklyTime)
-                                ByteBuffer out = WireCodec.newMessageBuffer(payloadLen);
-                                WireCodec.Header ch = new WireCodec.Header();
-                                ch.version = Protocol.VERSION;
-                                ch.opCode = Protocol.OP_QUERY_AVAIL;                             // same op for callback body
-                                ch.requestId = 0;                                                // callbacks need no dedupe by id
-                                ch.flags = Protocol.FLAG_IS_CALLBACK;                            // mark as callback
-                                ch.payloadLen = payloadLen;
-                                WireCodec.writeHeader(out, ch);
-                                WireCodec.writeU16(out, count);
-                                out.put((byte) day.value);                                       // write day
-                                for (Types.Interval iv : ivals) {
-                                    WireCodec.writeWeeklyTime(out, iv.start);
-                                    WireCodec.writeWeeklyTime(out, iv.end);
-                                }
-                                byte[] cb = out.array();
-                                for (MonitorRegistry.Entry m : monitors.getActiveFor(facility)) {
-                                    DatagramPacket mp = new DatagramPacket(cb, cb.length, m.addr, m.port);
-                                    if (rnd.nextDouble() >= lossSim) sock.send(mp);                  // send callback unless dropped
-                                }
-                            }
-                        }
-                    } catch (Exception ignore) { /* ignore callback errors to not impact main flow */ }
-                }
+        InetSocketAddress bound = (InetSocketAddress) first.getLocalAddress();        // resolves port 0
+        for (int i = 1; i < workers; i++) {
+            DatagramChannel ch = DatagramChannel.open();                               // one socket per worker
+            ch.setOption(StandardSocketOptions.SO_REUSEPORT, true);
+            ch.bind(bound);                                                            // same address and port
+            channels.add(ch);
+        }
+        return channels;
+    }
 
-            } catch (SocketTimeoutException ste) {
-                // Periodic maintenance on timeout
-                long now = System.currentTimeMillis();                    // current time
-                if (now - lastSweep > 1000) {                             // every second
-                    router.sweepCache();                                  // sweep cache
-                    monitors.sweepExpired();                              // sweep monitors
-                    lastSweep = now;                                      // update sweep ts
-                }
-            }
+    // Start the receive workers; worker i uses channel i modulo the number of channels
+    public static Thread[] startWorkers(List<DatagramChannel> channels, int workers, RequestRouter router,
+                                        CallbackFanout fanout, WriteAheadLog wal, double lossSim, RequestLog log) {
+        Thread[] threads = new Thread[workers];
+        for (int i = 0; i < workers; i++) {
+            DatagramChannel ch = channels.get(i % channels.size());           // blocking channel
+            ServerWorker w = new ServerWorker(ch, router, fanout, wal, lossSim, log);
+            threads[i] = new Thread(w, "udp-worker-" + i);
+            threads[i].start();
         }
+        return threads;
     }
 }
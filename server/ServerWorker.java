@@ -0,0 +1,165 @@
+/*
+ * ServerWorker.java
+ * Purpose: One UDP receive loop. Receives requests, routes them, sends responses, and
+ *          queues monitor callbacks on book/change/reset. Also supports simulated packet loss.
+ * Design notes:
+ * - ServerMain starts one worker per receive thread; each worker normally owns its own
+ *   SO_REUSEPORT socket so the kernel spreads datagrams across workers.
+ * - All shared state (store, cache, monitors) is reached through the router/registry objects.
+ * - Callbacks are queued only for the days the request changed, as reported in a ChangeSet;
+ *   CallbackFanout sends them on its own threads so the receive loop never waits on fan-out.
+ * - With a write-ahead log, a request that logged a mutation (ChangeSet LSN > 0) has its reply and
+ *   callbacks handed to WriteAheadLog.whenDurable; they go out from the log writer once the group
+ *   commit holding that LSN is on disk, and the worker moves on to the next datagram meanwhile.
+ * - Datagrams are received into one direct ByteBuffer per worker, reused for every request; the
+ *   router decodes straight from it. Header fields for the request log are read in place, so the
+ *   receive side allocates no byte[] per request.
+ * - Requests are logged by putting a binary record into RequestLog's ring (sampled, never
+ *   blocking); its own thread prints them. A held reply is logged when it is finally sent.
+ * - With latency stats on, the worker's RequestTimer times decode/logic/encode and the send
+ *   (for a held reply: until it is sent after the log write) into the router's LatencyStats.
+ *   With them off the timer is RequestTimer.OFF and nothing is timed or recorded.
+ * - Each request is also a ServerEvents.Request flight-recorder event. Its fields are filled in
+ *   only while a recording has the event enabled; otherwise the event object is optimized away.
+ *   The event never reaches the deferred-send closure, so it cannot escape.
+ * - Replies are encoded into a second direct buffer per worker (from WireCodec's per-thread pool)
+ *   and sent from it as is. Only a reply held for the log is copied out, since the buffer is
+ *   reused by the next request before the deferred send runs.
+ * - Monitor sweeps and at-most-once cache expiry run on their own threads, so a worker only
+ *   ever blocks in receive.
+ * - Malformed datagrams and socket errors are only counted (process-wide LongAdders reported by
+ *   OP_STATS), never printed, so a flood of junk cannot put blocking stdout writes on the
+ *   receive path.
+ */
+
+import java.net.*;
+import java.nio.ByteBuffer;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.DatagramChannel;
+import java.util.Random;
+import java.util.concurrent.atomic.LongAdder;
+
+public class ServerWorker implements Runnable {
+    private static final LongAdder MALFORMED = new LongAdder();     // requests dropped as malformed (all workers)
+    private static final LongAdder IO_ERRORS = new LongAdder();     // receive/send I/O errors, deferred sends included
+
+    private final DatagramChannel channel;     // receive/send channel (may be shared)
+    private final RequestRouter router;        // request routing
+    private final CallbackFanout fanout;       // asynchronous callback sender
+    private final WriteAheadLog wal;           // mutation log (null: replies go out at once)
+    private final double lossSim;              // probability to drop outbound responses
+    private final RequestLog log;              // request log (null: off)
+    private long seen;                         // requests received, for log sampling
+    private final ByteBuffer buf = ByteBuffer.allocateDirect(64 * 1024); // receive buffer (max UDP payload)
+    private ByteBuffer out;                    // reply buffer, taken from the pool on the worker thread
+    private final Random rnd = new Random();   // RNG for loss sim (per worker, no contention)
+    private final ChangeSet changes = new ChangeSet(); // days changed by the current request
+    private final LatencyStats stats;          // phase histograms (router's)
+    private final RequestTimer timer = new RequestTimer(); // phase timestamps and trace details
+
+    public ServerWorker(DatagramChannel channel, RequestRouter router, CallbackFanout fanout,
+                        WriteAheadLog wal, double lossSim, RequestLog log) {
+        this.channel = channel; this.router = router; this.fanout = fanout;                           // assign dependencies
+        this.wal = wal;                                                                                // assign log
+        this.lossSim = lossSim; this.log = log;                                                       // assign config
+        this.stats = router.stats();
+    }
+
+    @Override
+    public void run() {
+        out = WireCodec.acquireMessageBuffer();                           // kept for the worker's life
+        // Main loop; exits when the channel is closed
+        while (channel.isOpen()) {
+            try {
+                buf.clear();
+                InetSocketAddress from = (InetSocketAddress) channel.receive(buf); // blocking receive
+                buf.flip();                                               // [0, limit) is the datagram
+
+                // Header fields for the log record, read in place (the router parses the header itself)
+                int opCode = Short.toUnsignedInt(buf.getShort(2));        // see WireCodec.readHeader
+                long requestId = Integer.toUnsignedLong(buf.getInt(4));
+                long t0 = System.nanoTime();                              // start timing
+                ServerEvents.Request event = new ServerEvents.Request();  // scalar-replaced when not recording
+                boolean traced = event.isEnabled();
+                boolean timed = stats.enabled();
+                RequestTimer t = timed || traced ? timer : RequestTimer.OFF;
+                t.start();
+                event.begin();
+
+                // Handle request and construct response
+                changes.clear();                                          // reset per-request change set
+                router.handle(from.getAddress(), from.getPort(), buf, out, changes, t); // route, reply in out
+                long t1 = System.nanoTime();                              // routed
+                if (!out.hasRemaining()) continue;                        // duplicate still running elsewhere: no reply
+                int status = Short.toUnsignedInt(out.getShort(2));        // reply opCode (error bit on failure)
+
+                // Simulate loss if configured; the log record carries the drop
+                boolean drop = rnd.nextDouble() < lossSim;                // decided here: rnd is per worker
+                boolean logged = log != null && ++seen % log.sampleEvery() == 0; // sampled
+                int flags = drop ? RequestLog.FLAG_LOSS : 0;
+
+                boolean deferred = wal != null && changes.lsn() != 0;
+                if (traced) {
+                    event.op = opCode; event.requestId = requestId; event.status = status;
+                    event.facility = t.facility(); event.results = t.results();
+                    event.replyBytes = out.remaining(); event.deferred = deferred;
+                }
+
+                if (!deferred) {
+                    if (!drop) channel.send(out, from);                   // sendto, straight from out
+                    event.commit();                                       // no-op unless recording
+                    if (timed) stats.record(opCode, t.decodeNanos(), t.logicNanos(), t.encodeNanos(),
+                            System.nanoTime() - t.encodedAt());
+                    queueCallbacks(changes);
+                    if (logged) log.record(requestId, opCode, status, from.getAddress(), from.getPort(), flags,
+                            t0, t1 - t0, System.nanoTime() - t1);
+                } else {
+                    // Hold the reply and callbacks until the mutation is durable
+                    ChangeSet done = changes.copy();                      // changes is reused by the next request
+                    byte[] resp = new byte[out.remaining()];              // so is out
+                    out.get(resp);
+                    event.commit();                                       // handed off to the log
+                    long decodeNs = t.decodeNanos(), logicNs = t.logicNanos(), encodeNs = t.encodeNanos(); // timer is reused too
+                    long encodedAt = t.encodedAt();
+                    wal.whenDurable(done.lsn(), () -> {
+                        if (!drop) sendQuietly(resp, from);
+                        if (timed) stats.record(opCode, decodeNs, logicNs, encodeNs, System.nanoTime() - encodedAt); // send includes the wait
+                        queueCallbacks(done);
+                        if (logged) log.record(requestId, opCode, status, from.getAddress(), from.getPort(),
+                                flags | RequestLog.FLAG_DEFERRED, t0, t1 - t0, System.nanoTime() - t1); // send includes the wait
+                    });
+                }
+
+            } catch (ClosedChannelException closed) {
+                break;                                                    // channel closed: shut down worker
+            } catch (java.io.IOException ioe) {
+                IO_ERRORS.increment();                                    // keep serving
+            } catch (RuntimeException re) {
+                MALFORMED.increment();                                    // e.g. truncated header
+            }
+        }
+        WireCodec.releaseMessageBuffer(out);
+    }
+
+    // Queue callbacks only for the (facility, day) pairs a request changed
+    private void queueCallbacks(ChangeSet cs) {
+        for (int i = 0; i < cs.size(); i++) {
+            for (int mask = cs.dayMask(i); mask != 0; mask &= mask - 1) { // each changed day, no Day[] copy
+                fanout.submit(cs.facility(i), Types.Day.fromValue(Integer.numberOfTrailingZeros(mask))); // non-blocking
+            }
+        }
+    }
+
+    // Send a deferred reply (runs on the log writer thread)
+    private void sendQuietly(byte[] resp, InetSocketAddress to) {
+        try {
+            channel.send(ByteBuffer.wrap(resp), to);
+        } catch (java.io.IOException ioe) {
+            IO_ERRORS.increment();
+        }
+    }
+
+    // Metrics (all workers)
+    public static long malformedRequests() { return MALFORMED.sum(); }
+    public static long ioErrors() { return IO_ERRORS.sum(); }
+}
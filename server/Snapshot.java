@@ -0,0 +1,344 @@
+/*
+ * Snapshot.java
+ * Purpose: Compact binary image of a FacilityStore, written periodically in the background and
+ *          memory-mapped at startup, so a restart only replays the log written since.
+ * Design notes:
+ * - File (big-endian): magic "FBS2", u64 lsn, u64 nextBookingId; a string table (u32 count, then
+ *   u16 len + UTF-8 each); the facility table in ordinal order (u32 name + u64 facility lsn +
+ *   u32 booking count); u32 booking total, then the bookings as four columns, each grouped by
+ *   facility in start order: u64 id[], u32 user[], i32 start[], i32 end[] (week minutes); each
+ *   facility's OccupancyBitmap words (158 x u64, ordinal order); usage counters (u32 count, then
+ *   u32 name + i64 value); a trailing CRC32 of everything before it.
+ * - Loading bulk-copies each facility's columns straight from the mapped file into the arrays
+ *   its BookingIndex adopts, and its bitmap words into the bitmap (free-run tree and busy columns
+ *   rebuilt once per facility). Per booking only the Booking object and its id-map entry remain;
+ *   nothing is inserted, locked or re-indexed booking by booking.
+ * - Writing never stops request handling: each facility is copied under its read lock (writers
+ *   of that one facility wait for an array copy), then everything is encoded and written off-lock.
+ * - Consistency with the log: lsn is the log's last LSN read before any copying, so every record
+ *   at or below it is in the image. Each facility also stores the last LSN read while its lock
+ *   was held: its own records up to that LSN are in the image and are skipped on replay, later
+ *   ones are not. Replay therefore never re-applies an older CHANGE over a newer position.
+ * - Usage counters and the id counter are read after the copies and replay with max(), so they
+ *   need no per-facility LSN.
+ * - Files are snapshot-<lsn>.bin, written as .tmp, forced, then renamed. The newest two are kept
+ *   and loading falls back to the older one if the newer fails its CRC, so log segments are only
+ *   deleted up to the older one's lsn. A .tmp left by a crash mid-write is deleted at startup.
+ */
+
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InterruptedIOException;
+import java.nio.ByteBuffer;
+import java.nio.LongBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.DirectoryStream;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardCopyOption;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.CountDownLatch;
+import java.util.zip.CRC32;
+import java.util.zip.CheckedOutputStream;
+
+public class Snapshot {
+    private static final int MAGIC = 0x46425332;                // "FBS2": columnar bookings + bitmap words
+    private static final int KEEP = 2;                          // snapshots kept on disk
+
+    // What a loaded snapshot covers; replay skips records it already holds
+    public static final class Loaded {
+        public final long lsn;                                  // every record <= lsn is in the image
+        public final int bookings;                              // bookings loaded
+        private final Map<String, Long> facilityLsn;            // per-facility coverage (>= lsn)
+
+        Loaded(long lsn, int bookings, Map<String, Long> facilityLsn) {
+            this.lsn = lsn;
+            this.bookings = bookings;
+            this.facilityLsn = facilityLsn;
+        }
+
+        // True if the record at lsn is already reflected in the image
+        public boolean covers(long recordLsn, ByteBuffer body, FacilityStore store) {
+            if (recordLsn <= lsn) return true;
+            String facility = WalRecord.facilityOf(body, store);
+            if (facility == null) return false;                 // counters, unknown bookings: replay is harmless
+            Long upTo = facilityLsn.get(facility);
+            return upTo != null && recordLsn <= upTo;
+        }
+    }
+
+    // One facility copied under its read lock
+    private static final class FacilityCopy {
+        final String name;
+        final long lsn;                                         // log position the copy matches
+        final long[] ids;
+        final String[] users;
+        final int[] starts, ends;                               // week minutes
+        final long[] words;                                     // occupancy bitmap words
+
+        FacilityCopy(Types.Facility f, long lsn) {
+            int n = f.bookings.size();
+            this.name = f.name;
+            this.lsn = lsn;
+            this.ids = new long[n];
+            this.users = new String[n];
+            this.starts = new int[n];
+            this.ends = new int[n];
+            for (int i = 0; i < n; i++) {
+                Types.Booking b = f.bookings.get(i);
+                ids[i] = b.id;
+                users[i] = b.user;
+                starts[i] = f.bookings.startAt(i);
+                ends[i] = f.bookings.endAt(i);
+            }
+            this.words = f.occupancy.copyWords();
+        }
+    }
+
+    private final Path dir;                                     // snapshot directory
+    private final FacilityStore store;                          // state to image
+    private final WriteAheadLog wal;                            // log whose LSNs the image refers to
+    private volatile long lastLsn = -1;                         // lsn of the newest snapshot written
+
+    public Snapshot(Path dir, FacilityStore store, WriteAheadLog wal) throws IOException {
+        this.dir = Files.createDirectories(dir);
+        this.store = store;
+        this.wal = wal;
+    }
+
+    // Load the newest valid snapshot into the (empty) store; an empty Loaded if there is none
+    public Loaded load() throws IOException {
+        try (DirectoryStream<Path> ds = Files.newDirectoryStream(dir, "snapshot-*.tmp")) {
+            for (Path p : ds) Files.deleteIfExists(p);          // a write cut short by a crash
+        }
+        List<Path> files = files();
+        for (int i = files.size() - 1; i >= 0; i--) {
+            Loaded l = read(files.get(i), store);
+            if (l != null) {
+                lastLsn = l.lsn;
+                return l;
+            }
+            System.out.println("[snapshot] skipping damaged " + files.get(i).getFileName());
+        }
+        return new Loaded(0, 0, Collections.emptyMap());
+    }
+
+    // Write snapshots every intervalMs on a daemon thread, when the log has moved on
+    public void start(long intervalMs) {
+        Thread t = new Thread(() -> {
+            while (true) {
+                try {
+                    Thread.sleep(intervalMs);
+                } catch (InterruptedException ie) {
+                    return;                                     // shutdown
+                }
+                if (wal.lastLsn() == lastLsn) continue;         // nothing new since the last one
+                try {
+                    long t0 = System.nanoTime();
+                    long lsn = write();
+                    System.out.printf("[snapshot] lsn=%d written in %.1f ms%n", lsn, (System.nanoTime() - t0) / 1e6);
+                } catch (IOException ioe) {
+                    System.out.println("[snapshot] write failed: " + ioe.getMessage()); // the log still has it all
+                }
+            }
+        }, "snapshot-writer");
+        t.setDaemon(true);
+        t.start();
+    }
+
+    // Write a snapshot of the current state, prune old files and covered log segments; returns its lsn
+    public synchronized long write() throws IOException {
+        long lsn = wal.lastLsn();                               // before any copy: everything <= lsn is applied
+        FacilityColumns columns = store.columns();
+        List<FacilityCopy> copies = new ArrayList<>();
+        for (int o = 0, n = columns.size(); o < n; o++) {
+            Types.Facility f = columns.facility(o);
+            f.lock.readLock().lock();
+            try {
+                copies.add(new FacilityCopy(f, wal.lastLsn())); // no record for f can be appended meanwhile
+            } finally {
+                f.lock.readLock().unlock();
+            }
+        }
+        long maxLsn = lsn;
+        for (FacilityCopy c : copies) maxLsn = Math.max(maxLsn, c.lsn);
+        Map<String, Long> usage = new HashMap<>(store.usageCounters());
+        long nextId = store.peekNextBookingId();
+
+        Path tmp = dir.resolve(String.format("snapshot-%020d.tmp", lsn));
+        try (FileOutputStream fos = new FileOutputStream(tmp.toFile())) {
+            CRC32 crc = new CRC32();
+            DataOutputStream out = new DataOutputStream(new BufferedOutputStream(new CheckedOutputStream(fos, crc), 1 << 16));
+            encode(out, lsn, nextId, copies, usage);
+            out.flush();
+            out.writeInt((int) crc.getValue());                 // trailer, outside the checksum
+            out.flush();
+            fos.getChannel().force(true);
+        }
+        awaitDurable(maxLsn);                                   // never image records the log could still lose
+        Files.move(tmp, dir.resolve(String.format("snapshot-%020d.bin", lsn)), StandardCopyOption.ATOMIC_MOVE);
+        lastLsn = lsn;
+
+        List<Path> files = files();
+        for (int i = 0; i + KEEP < files.size(); i++) Files.deleteIfExists(files.get(i));
+        files = files();
+        wal.deleteSegmentsThrough(fileLsn(files.get(0)));       // oldest kept snapshot still needs the rest
+        return lsn;
+    }
+
+    private static void encode(DataOutputStream out, long lsn, long nextId, List<FacilityCopy> copies,
+                               Map<String, Long> usage) throws IOException {
+        Map<String, Integer> strings = new LinkedHashMap<>();  // string -> table index
+        int bookings = 0;
+        for (FacilityCopy c : copies) {
+            intern(strings, c.name);
+            for (String u : c.users) intern(strings, u);
+            bookings += c.ids.length;
+        }
+        for (String name : usage.keySet()) intern(strings, name);
+
+        out.writeInt(MAGIC);
+        out.writeLong(lsn);
+        out.writeLong(nextId);
+        out.writeInt(strings.size());
+        for (String s : strings.keySet()) {
+            byte[] b = s.getBytes(StandardCharsets.UTF_8);
+            out.writeShort(b.length);
+            out.write(b);
+        }
+        out.writeInt(copies.size());
+        for (FacilityCopy c : copies) {
+            out.writeInt(strings.get(c.name));
+            out.writeLong(c.lsn);
+            out.writeInt(c.ids.length);
+        }
+        out.writeInt(bookings);
+        for (FacilityCopy c : copies) for (long id : c.ids) out.writeLong(id);           // column by column
+        for (FacilityCopy c : copies) for (String u : c.users) out.writeInt(strings.get(u));
+        for (FacilityCopy c : copies) for (int v : c.starts) out.writeInt(v);
+        for (FacilityCopy c : copies) for (int v : c.ends) out.writeInt(v);
+        for (FacilityCopy c : copies) for (long w : c.words) out.writeLong(w);
+        out.writeInt(usage.size());
+        for (Map.Entry<String, Long> e : usage.entrySet()) {
+            out.writeInt(strings.get(e.getKey()));
+            out.writeLong(e.getValue());
+        }
+    }
+
+    // Map and decode one file; null if it is damaged (nothing is added to the store then)
+    private static Loaded read(Path file, FacilityStore store) throws IOException {
+        MappedByteBuffer in;
+        try (FileChannel ch = FileChannel.open(file, StandardOpenOption.READ)) {
+            in = ch.map(FileChannel.MapMode.READ_ONLY, 0, ch.size());  // stays valid after close
+        }
+        if (in.capacity() < 4 + 8 + 8 + 4) return null;
+        CRC32 crc = new CRC32();
+        ByteBuffer body = in.duplicate();
+        body.limit(in.capacity() - 4);
+        crc.update(body);
+        if ((int) crc.getValue() != in.getInt(in.capacity() - 4)) return null;
+        if (in.getInt() != MAGIC) return null;
+
+        long lsn = in.getLong();
+        long nextId = in.getLong();
+        String[] strings = new String[in.getInt()];
+        for (int i = 0; i < strings.length; i++) {
+            byte[] b = new byte[Short.toUnsignedInt(in.getShort())];
+            in.get(b);
+            strings[i] = new String(b, StandardCharsets.UTF_8);
+        }
+        int facilities = in.getInt();
+        Types.Facility[] facs = new Types.Facility[facilities];
+        int[] counts = new int[facilities];
+        Map<String, Long> facilityLsn = new HashMap<>();
+        for (int i = 0; i < facilities; i++) {
+            String name = strings[in.getInt()];
+            facilityLsn.put(name, in.getLong());
+            counts[i] = in.getInt();
+            facs[i] = store.ensureFacility(name);               // same ordinals as before the restart
+        }
+        int bookings = in.getInt();
+        readColumns(in, store, strings, facs, counts, bookings);
+        for (int i = 0, n = in.getInt(); i < n; i++) {
+            String name = strings[in.getInt()];
+            store.raiseUsage(name, in.getLong());
+        }
+        store.reserveBookingIds(nextId);
+        return new Loaded(lsn, bookings, facilityLsn);
+    }
+
+    // Bulk-copy each facility's slice of the columns and its bitmap words
+    private static void readColumns(ByteBuffer in, FacilityStore store, String[] strings, Types.Facility[] facs,
+                                    int[] counts, int total) {
+        int idsAt = in.position();                              // column offsets
+        int usersAt = idsAt + 8 * total;
+        int startsAt = usersAt + 4 * total;
+        int endsAt = startsAt + 4 * total;
+        int wordsAt = endsAt + 4 * total;
+        int[] users = new int[0];
+        long[] ids = new long[0];
+        for (int i = 0, off = 0; i < facs.length; off += counts[i], i++) {
+            int n = counts[i], cap = Math.max(n, 1);
+            if (ids.length < n) { ids = new long[n]; users = new int[n]; } // scratch, reused across facilities
+            column(in, idsAt + 8 * off).asLongBuffer().get(ids, 0, n);
+            column(in, usersAt + 4 * off).asIntBuffer().get(users, 0, n);
+            int[] starts = new int[cap], ends = new int[cap];  // adopted by the BookingIndex
+            column(in, startsAt + 4 * off).asIntBuffer().get(starts, 0, n);
+            column(in, endsAt + 4 * off).asIntBuffer().get(ends, 0, n);
+            Types.Booking[] items = new Types.Booking[cap];
+            String name = facs[i].name;
+            for (int k = 0; k < n; k++) items[k] = new Types.Booking(ids[k], name, strings[users[k]], starts[k], ends[k]);
+            LongBuffer words = column(in, wordsAt + 8 * OccupancyBitmap.WORDS * i).asLongBuffer();
+            store.loadFacility(facs[i], items, starts, ends, n, words);
+        }
+        in.position(wordsAt + 8 * OccupancyBitmap.WORDS * facs.length); // usage counters follow
+    }
+
+    // View of the mapped file starting at byte offset at
+    private static ByteBuffer column(ByteBuffer in, int at) {
+        ByteBuffer b = in.duplicate();
+        b.position(at);
+        return b;
+    }
+
+    private void awaitDurable(long lsn) throws IOException {
+        CountDownLatch durable = new CountDownLatch(1);
+        wal.whenDurable(lsn, durable::countDown);
+        try {
+            durable.await();
+        } catch (InterruptedException ie) {
+            throw new InterruptedIOException("interrupted waiting for the log");
+        }
+    }
+
+    private static void intern(Map<String, Integer> strings, String s) {
+        if (!strings.containsKey(s)) strings.put(s, strings.size());
+    }
+
+    // Snapshot files sorted by lsn (zero-padded names sort numerically)
+    private List<Path> files() throws IOException {
+        List<Path> out = new ArrayList<>();
+        try (DirectoryStream<Path> ds = Files.newDirectoryStream(dir, "snapshot-*.bin")) {
+            for (Path p : ds) out.add(p);
+        }
+        out.sort(null);
+        return out;
+    }
+
+    private static long fileLsn(Path file) {
+        String name = file.getFileName().toString();           // snapshot-<20 digits>.bin
+        return Long.parseLong(name.substring(9, name.length() - 4));
+    }
+
+    public long lastLsn() { return lastLsn; }
+}
@@ -0,0 +1,112 @@
+/*
+ * WalRecord.java
+ * Purpose: Encodes mutations as write-ahead log record bodies and replays them into a FacilityStore.
+ * Design notes:
+ * - Body: u8 type + fields, big-endian, strings as u16 length + UTF-8 (same as the wire format).
+ * - Records hold absolute results rather than requests: the booking id and both week minutes
+ *   for BOOK, the new position for CHANGE, the new counter value for INCR. Replaying a record
+ *   twice, or replaying INCRs out of order, leaves the same state.
+ * - RESET holds facility + day; replayed in log order it removes the same bookings it did live.
+ * - Replay skips the conflict checks: the log only holds mutations that already passed them.
+ */
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
+public final class WalRecord {
+    public static final int BOOK = 1;     // u64 id + str facility + str user + u16 start + u16 end
+    public static final int CHANGE = 2;   // u64 id + u16 start + u16 end
+    public static final int RESET = 3;    // str facility + u8 day
+    public static final int INCR = 4;     // str facility + i64 value
+
+    private WalRecord() {}
+
+    public static byte[] book(long id, String facility, String user, int start, int end) {
+        byte[] f = utf8(facility), u = utf8(user);
+        ByteBuffer out = ByteBuffer.allocate(1 + 8 + 2 + f.length + 2 + u.length + 4);
+        out.put((byte) BOOK).putLong(id);
+        out.putShort((short) f.length).put(f);
+        out.putShort((short) u.length).put(u);
+        out.putShort((short) start).putShort((short) end);
+        return out.array();
+    }
+
+    public static byte[] change(long id, int start, int end) {
+        ByteBuffer out = ByteBuffer.allocate(1 + 8 + 4);
+        out.put((byte) CHANGE).putLong(id).putShort((short) start).putShort((short) end);
+        return out.array();
+    }
+
+    public static byte[] reset(String facility, Types.Day day) {
+        byte[] f = utf8(facility);
+        ByteBuffer out = ByteBuffer.allocate(1 + 2 + f.length + 1);
+        out.put((byte) RESET).putShort((short) f.length).put(f).put((byte) day.value);
+        return out.array();
+    }
+
+    public static byte[] incr(String facility, long value) {
+        byte[] f = utf8(facility);
+        ByteBuffer out = ByteBuffer.allocate(1 + 2 + f.length + 8);
+        out.put((byte) INCR).putShort((short) f.length).put(f).putLong(value);
+        return out.array();
+    }
+
+    // Apply one record body to the store (startup replay; no locks contended yet)
+    public static void apply(ByteBuffer in, FacilityStore store) {
+        int type = in.get();
+        switch (type) {
+            case BOOK: {
+                long id = in.getLong();
+                String facility = str(in), user = str(in);
+                int start = Short.toUnsignedInt(in.getShort()), end = Short.toUnsignedInt(in.getShort());
+                if (store.getBooking(id) == null) {
+                    store.addBooking(new Types.Booking(id, facility, user, start, end));
+                }
+                store.reserveBookingIds(id + 1);                  // never hand out a logged id again
+                break;
+            }
+            case CHANGE: {
+                Types.Booking b = store.getBooking(in.getLong());
+                int start = Short.toUnsignedInt(in.getShort()), end = Short.toUnsignedInt(in.getShort());
+                if (b != null) store.moveBooking(b, start, end);
+                break;
+            }
+            case RESET: {
+                String facility = str(in);
+                store.removeBookingsForDay(facility, Types.Day.fromValue(in.get()), null);
+                break;
+            }
+            case INCR: {
+                String facility = str(in);
+                store.raiseUsage(facility, in.getLong());
+                break;
+            }
+            default:
+                throw new IllegalStateException("unknown WAL record type " + type);
+        }
+    }
+
+    // Facility a record mutates, or null for INCR and for a CHANGE of an unknown booking
+    public static String facilityOf(ByteBuffer body, FacilityStore store) {
+        ByteBuffer in = body.duplicate();
+        switch (in.get()) {
+            case BOOK: in.getLong(); return str(in);
+            case CHANGE: {
+                Types.Booking b = store.getBooking(in.getLong());
+                return b == null ? null : b.facility;
+            }
+            case RESET: return str(in);
+            default: return null;
+        }
+    }
+
+    private static byte[] utf8(String s) {
+        return s.getBytes(StandardCharsets.UTF_8);
+    }
+
+    private static String str(ByteBuffer in) {
+        byte[] b = new byte[Short.toUnsignedInt(in.getShort())];
+        in.get(b);
+        return new String(b, StandardCharsets.UTF_8);
+    }
+}
@@ -0,0 +1,241 @@
+/*
+ * WriteAheadLog.java
+ * Purpose: Append-only binary log of mutations with group commit, so bookings survive a restart
+ *          without an fsync per request.
+ * Design notes:
+ * - Frame: u32 bodyLen + u64 lsn + body + u32 CRC32(lsn + body). LSNs are dense and increasing.
+ *   Bodies are WalRecord entries; this class only moves bytes.
+ * - append() copies the frame into the pending buffer under the log's monitor and returns the
+ *   LSN; it never touches the disk. Callers append while still holding the facility lock, so
+ *   records for one facility are logged in the order they were applied.
+ * - A dedicated writer thread collects everything appended within --walWindowUs of the first
+ *   pending record (or until --walBatchBytes are pending), writes it with one write + force,
+ *   then publishes the durable LSN and runs the whenDurable() actions it released.
+ * - Replies wait in whenDurable(); with a zero window the writer still batches whatever arrived
+ *   while the previous force was running.
+ * - Segments are named by their first LSN. start() opens a fresh one; the writer rolls over to a
+ *   new one once the current segment passes segmentBytes. Segments wholly covered by a snapshot
+ *   are removed with deleteSegmentsThrough(); the open segment is never removed.
+ * - recover() replays segments in LSN order, skipping those wholly at or below the snapshot LSN,
+ *   and stops a segment at the first torn or corrupt frame (a crash mid-write).
+ * - A write or force failure stops the process: replies must not be sent for lost records.
+ */
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.file.DirectoryStream;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.PriorityQueue;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.zip.CRC32;
+
+public class WriteAheadLog {
+    public static final long DEFAULT_WINDOW_US = 1000;          // default group-commit window
+    public static final int DEFAULT_BATCH_BYTES = 256 * 1024;   // default early-flush threshold
+    public static final long DEFAULT_SEGMENT_BYTES = 64L << 20; // default segment size before rolling over
+    private static final int FRAME_OVERHEAD = 4 + 8 + 4;        // len + lsn + crc
+
+    // Replay callback: one record body per call, in LSN order
+    public interface Replayer {
+        void apply(long lsn, ByteBuffer body);
+    }
+
+    // Action released once its LSN is durable
+    private static final class Waiter {
+        final long lsn;                                         // LSN to wait for
+        final Runnable action;                                  // e.g. send the reply
+        Waiter(long lsn, Runnable action) { this.lsn = lsn; this.action = action; }
+    }
+
+    private final Path dir;                                     // segment directory
+    private final long windowNanos;                             // group-commit window
+    private final int batchBytes;                               // flush early at this many pending bytes
+    private final long segmentBytes;                            // roll over past this segment size
+    private FileChannel segment;                                // open segment (writer thread only after start)
+    private volatile long segmentFirstLsn;                      // first LSN of the open segment
+    private ByteBuffer pending = ByteBuffer.allocate(64 * 1024); // frames not yet written (guarded by this)
+    private ByteBuffer writing = ByteBuffer.allocate(64 * 1024); // frames being written (writer thread)
+    private long lastLsn;                                       // last LSN handed out (guarded by this)
+    private volatile long durableLsn;                           // every LSN <= this is on disk
+    private final PriorityQueue<Waiter> waiters = new PriorityQueue<>((a, b) -> Long.compare(a.lsn, b.lsn)); // guarded by this
+    private final CRC32 crc = new CRC32();                      // frame checksum (guarded by this)
+
+    private final LongAdder records = new LongAdder();          // records appended
+    private final LongAdder commits = new LongAdder();          // write + force rounds
+    private final LongAdder bytes = new LongAdder();            // bytes written
+
+    public WriteAheadLog(Path dir, long windowMicros, int batchBytes) throws IOException {
+        this(dir, windowMicros, batchBytes, DEFAULT_SEGMENT_BYTES);
+    }
+
+    public WriteAheadLog(Path dir, long windowMicros, int batchBytes, long segmentBytes) throws IOException {
+        this.dir = Files.createDirectories(dir);
+        this.windowNanos = Math.max(0, windowMicros) * 1000L;
+        this.batchBytes = Math.max(1, batchBytes);
+        this.segmentBytes = Math.max(1, segmentBytes);
+    }
+
+    // Replay all segments in LSN order; returns the last LSN seen. Call before start().
+    public long recover(Replayer replayer) throws IOException {
+        return recover(0, replayer);
+    }
+
+    // Replay records after afterLsn (a snapshot's LSN) in LSN order; returns the last LSN, at least afterLsn
+    public synchronized long recover(long afterLsn, Replayer replayer) throws IOException {
+        lastLsn = Math.max(lastLsn, afterLsn);                      // the snapshot already holds these
+        List<Path> segs = segments();
+        for (int i = 0; i < segs.size(); i++) {
+            if (i + 1 < segs.size() && firstLsn(segs.get(i + 1)) - 1 <= afterLsn) continue; // wholly covered
+            ByteBuffer buf = ByteBuffer.wrap(Files.readAllBytes(segs.get(i)));
+            CRC32 check = new CRC32();
+            while (buf.remaining() >= FRAME_OVERHEAD) {
+                int start = buf.position();
+                int len = buf.getInt();
+                if (len < 0 || len > buf.remaining() - 12) break;   // torn tail
+                long lsn = buf.getLong();
+                check.reset();
+                check.update(buf.array(), start + 4, 8 + len);      // lsn + body
+                buf.position(start + 12 + len);
+                if ((int) check.getValue() != buf.getInt()) break;  // corrupt or half-written frame
+                if (lsn <= lastLsn) continue;                       // already applied
+                ByteBuffer body = ByteBuffer.wrap(buf.array(), start + 12, len).slice();
+                replayer.apply(lsn, body);
+                lastLsn = lsn;
+            }
+        }
+        durableLsn = lastLsn;
+        return lastLsn;
+    }
+
+    // Open a new segment and start the writer thread
+    public synchronized void start() throws IOException {
+        openSegment(lastLsn + 1);
+        Thread t = new Thread(this::writeLoop, "wal-writer");
+        t.setDaemon(true);
+        t.start();
+    }
+
+    // Append one record body; returns its LSN (durable once whenDurable fires for it)
+    public synchronized long append(byte[] body) {
+        long lsn = ++lastLsn;
+        int need = FRAME_OVERHEAD + body.length;
+        if (pending.remaining() < need) {                          // grow, keeping what is pending
+            ByteBuffer grown = ByteBuffer.allocate(Math.max(pending.capacity() * 2, pending.position() + need));
+            pending.flip();
+            grown.put(pending);
+            pending = grown;
+        }
+        int start = pending.position();
+        pending.putInt(body.length).putLong(lsn).put(body);
+        crc.reset();
+        crc.update(pending.array(), start + 4, 8 + body.length);   // lsn + body
+        pending.putInt((int) crc.getValue());
+        records.increment();
+        if (start == 0 || pending.position() >= batchBytes) notifyAll(); // open a window, or flush early
+        return lsn;
+    }
+
+    // Run action once lsn is durable: now on the caller if it already is, else on the writer thread
+    public void whenDurable(long lsn, Runnable action) {
+        if (lsn > durableLsn) {
+            synchronized (this) {
+                if (lsn > durableLsn) { waiters.add(new Waiter(lsn, action)); return; }
+            }
+        }
+        action.run();
+    }
+
+    private void writeLoop() {
+        List<Runnable> released = new ArrayList<>();
+        while (true) {
+            long batchLsn;
+            try {
+                synchronized (this) {
+                    while (pending.position() == 0) wait();
+                    long deadline = System.nanoTime() + windowNanos;   // window opens at the first record
+                    long left;
+                    while (pending.position() < batchBytes && (left = deadline - System.nanoTime()) > 0) {
+                        TimeUnit.NANOSECONDS.timedWait(this, left);
+                    }
+                    ByteBuffer full = pending;                         // swap: appends continue meanwhile
+                    pending = writing;
+                    writing = full;
+                    batchLsn = lastLsn;
+                }
+            } catch (InterruptedException ie) {
+                return;                                                // shutdown
+            }
+            try {
+                writing.flip();
+                bytes.add(writing.remaining());
+                while (writing.hasRemaining()) segment.write(writing);
+                segment.force(false);                                  // one fsync for the whole batch
+                writing.clear();
+                if (segment.size() >= segmentBytes) {                  // roll over between batches
+                    segment.close();
+                    openSegment(batchLsn + 1);
+                }
+            } catch (IOException ioe) {
+                System.out.println("[wal] write failed, stopping: " + ioe.getMessage());
+                System.exit(1);                                        // never acknowledge lost records
+            }
+            commits.increment();
+            synchronized (this) {
+                durableLsn = batchLsn;
+                while (!waiters.isEmpty() && waiters.peek().lsn <= batchLsn) released.add(waiters.poll().action);
+            }
+            for (Runnable r : released) {
+                try {
+                    r.run();
+                } catch (RuntimeException re) {
+                    System.out.println("[wal] durable action failed: " + re);
+                }
+            }
+            released.clear();
+        }
+    }
+
+    // Delete segments whose records are all <= lsn (covered by a snapshot); never the open one
+    public void deleteSegmentsThrough(long lsn) throws IOException {
+        List<Path> segs = segments();
+        for (int i = 0; i + 1 < segs.size(); i++) {
+            long next = firstLsn(segs.get(i + 1));
+            if (next - 1 > lsn || firstLsn(segs.get(i)) >= segmentFirstLsn) break;
+            Files.deleteIfExists(segs.get(i));
+        }
+    }
+
+    private void openSegment(long firstLsn) throws IOException {
+        segment = FileChannel.open(dir.resolve(String.format("wal-%020d.log", firstLsn)),
+                StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.APPEND);
+        segmentFirstLsn = firstLsn;
+    }
+
+    private static long firstLsn(Path segment) {
+        String name = segment.getFileName().toString();             // wal-<20 digits>.log
+        return Long.parseLong(name.substring(4, name.length() - 4));
+    }
+
+    // Segment files sorted by first LSN (zero-padded names sort numerically)
+    private List<Path> segments() throws IOException {
+        List<Path> out = new ArrayList<>();
+        try (DirectoryStream<Path> ds = Files.newDirectoryStream(dir, "wal-*.log")) {
+            for (Path p : ds) out.add(p);
+        }
+        out.sort(null);
+        return out;
+    }
+
+    // Metrics
+    public long durableLsn() { return durableLsn; }
+    public synchronized long lastLsn() { return lastLsn; }
+    public long records() { return records.sum(); }
+    public long commits() { return commits.sum(); }
+    public long bytesWritten() { return bytes.sum(); }
+}